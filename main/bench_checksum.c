@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "packet.h"
+#include "checksum.h"
+
+// how many bytes every measurement goes through
+#define BENCH_BYTES (1ULL << 30)
+
+// checksums a gigabyte one packet at a time, as the sender and the receiver do, and copies it the same way
+// the copy is what every packet already costs, the checksum comes on top of it
+int main(int argc, char **argv) {
+    size_t total = argc > 1 ? strtoull(argv[1], NULL, 0) << 20 : BENCH_BYTES;
+    size_t buffer_size = 1 << 20;
+    char *src = malloc(buffer_size);
+    char *dst = malloc(buffer_size);
+    for (size_t i = 0; i < buffer_size; i++) {
+        src[i] = rand();
+    }
+
+    // the known answer for "123456789" makes sure we measure a correct CRC32C
+    if (crc32c(0, "123456789", 9) != 0xe3069283) {
+        fprintf(stderr, "ERROR, crc32c gives the wrong checksum\n");
+        exit(1);
+    }
+
+    // the checksums go into sink so that the compiler cannot drop the loop
+    uint32_t sink = 0;
+    uint64_t start = now_usec();
+    for (size_t done = 0; done < total; done += buffer_size) {
+        for (size_t off = 0; off + DATA_SIZE <= buffer_size; off += DATA_SIZE) {
+            sink += crc32c(0, src + off, DATA_SIZE);
+        }
+    }
+    double crc_time = (now_usec() - start) / 1000000.0;
+
+    start = now_usec();
+    for (size_t done = 0; done < total; done += buffer_size) {
+        for (size_t off = 0; off + DATA_SIZE <= buffer_size; off += DATA_SIZE) {
+            memcpy(dst + off, src + off, DATA_SIZE);
+        }
+        sink += dst[done % buffer_size];
+    }
+    double copy_time = (now_usec() - start) / 1000000.0;
+
+    double gb = total / (double) (1 << 30);
+    printf("crc32c: %.3f s/GB, %.2f GB/s\n", crc_time / gb, gb / crc_time);
+    printf("memcpy: %.3f s/GB, %.2f GB/s\n", copy_time / gb, gb / copy_time);
+    printf("crc32c costs %.2f times a copy of the packet (%u)\n", crc_time / copy_time, sink & 1);
+
+    free(src);
+    free(dst);
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <poll.h>
+#include <inttypes.h>
+#include <sys/wait.h>
+
+#include "common.h"
+#include "rdt.h"
+
+// how many megabytes every measurement moves unless the first argument says otherwise
+#define BENCH_MB 256
+
+// the raw receiver gives up once nothing arrived for this many milliseconds, a UDP sender's last packets may be lost
+#define RAW_IDLE_MS 500
+
+// the first byte of the packet that ends a raw run
+#define RAW_END 0xff
+
+static transport * bench_listen(int shared_memory, int port) {
+    transport *t = shared_memory ? shm_listen(port) : udp_listen(port);
+    if (t == NULL) {
+        error("listen");
+    }
+    return t;
+}
+
+static transport * bench_connect(int shared_memory, int port) {
+    transport *t = shared_memory ? shm_connect(port) : udp_connect("127.0.0.1", port);
+    if (t == NULL) {
+        error("connect");
+    }
+    return t;
+}
+
+// counts the packets that arrive until the end packet or until the sender went quiet, and writes the count to result
+static void raw_receiver(transport *t, int result) {
+    char pkt[MSS_SIZE];
+    int64_t packets = 0;
+
+    while (1) {
+        struct pollfd pfd = {.fd = t->fd, .events = POLLIN};
+        if (poll(&pfd, 1, RAW_IDLE_MS) == 0) {
+            break;
+        }
+        long n = t->recv(t, pkt, MSS_SIZE, NULL);
+        if (n <= 0) {
+            continue;
+        }
+        if ((unsigned char) pkt[0] == RAW_END) {
+            break;
+        }
+        packets++;
+    }
+    if (write(result, &packets, sizeof(packets)) != sizeof(packets)) {
+        error("write");
+    }
+}
+
+// pushes packets through the transport as fast as it takes them, with nothing on top of it
+static void raw_sender(transport *t, int64_t packets) {
+    char pkt[MSS_SIZE];
+    memset(pkt, 0, MSS_SIZE);
+
+    // a full ring or socket buffer is waited out, so we measure what the transport can carry
+    for (int64_t i = 0; i < packets; i++) {
+        while (t->send(t, pkt, MSS_SIZE, NULL) < 0) {
+            if (errno != ENOBUFS && errno != EAGAIN) {
+                error("send");
+            }
+            sched_yield();
+        }
+    }
+
+    // the end packet is repeated, on UDP one of them may be lost
+    pkt[0] = (char) RAW_END;
+    for (int i = 0; i < 3; i++) {
+        t->send(t, pkt, MSS_SIZE, NULL);
+    }
+}
+
+// accepts one connection and reads its stream to the end, the number of bytes goes to result
+static void stream_receiver(transport *t, int result) {
+    char buffer[16 * DATA_SIZE];
+    rdt_listener *listener = rdt_listen(t);
+    rdt_conn *conn = NULL;
+    int64_t bytes = 0;
+
+    while (1) {
+        struct pollfd pfd = {.fd = rdt_listener_fd(listener), .events = POLLIN};
+        poll(&pfd, 1, rdt_listener_timeout(listener));
+        rdt_listener_tick(listener);
+        if (conn == NULL) {
+            conn = rdt_accept(listener);
+            if (conn != NULL) {
+                rdt_start(conn, 0, 0);
+            }
+            continue;
+        }
+        if (rdt_ready(listener) == NULL) {
+            continue;
+        }
+
+        long len;
+        while ((len = rdt_read(conn, buffer, sizeof(buffer))) > 0) {
+            bytes += len;
+        }
+        if (len == 0) {
+            break;
+        }
+    }
+
+    // the sender waits for our FIN_ACK, we answer its FINs until it stops sending them
+    while (rdt_idle(conn) < RAW_IDLE_MS) {
+        struct pollfd pfd = {.fd = rdt_listener_fd(listener), .events = POLLIN};
+        poll(&pfd, 1, RAW_IDLE_MS);
+        rdt_listener_tick(listener);
+    }
+    if (write(result, &bytes, sizeof(bytes)) != sizeof(bytes)) {
+        error("write");
+    }
+    rdt_close(conn);
+    rdt_listener_close(listener);
+}
+
+// writes bytes through a connection and waits until the receiver ACKed its FIN
+static void stream_sender(transport *t, int64_t bytes) {
+    char buffer[DATA_SIZE];
+    memset(buffer, 0, sizeof(buffer));
+    rdt_conn *conn = rdt_connect(t, 0, 0);
+    int64_t written = 0;
+
+    while (rdt_state(conn) == RDT_SYN_SENT || rdt_state(conn) == RDT_ESTABLISHED) {
+        while (rdt_state(conn) == RDT_ESTABLISHED && written < bytes) {
+            size_t len = bytes - written < DATA_SIZE ? bytes - written : DATA_SIZE;
+            long n = rdt_write(conn, buffer, len);
+            if (n < 0) {
+                break;
+            }
+            written += n;
+            if (written == bytes) {
+                rdt_shutdown(conn);
+            }
+        }
+
+        struct pollfd pfd = {.fd = rdt_fd(conn), .events = POLLIN};
+        poll(&pfd, 1, rdt_timeout(conn));
+        rdt_tick(conn);
+    }
+    if (rdt_state(conn) != RDT_CLOSED) {
+        fprintf(stderr, "ERROR, the transfer did not complete\n");
+        exit(1);
+    }
+    rdt_close(conn);
+}
+
+// runs one measurement with the receiver in a child process, returns what the receiver counted and sets *seconds
+static int64_t run(int shared_memory, int raw, int port, int64_t bytes, double *seconds) {
+    int ready[2], result[2];
+    if (pipe(ready) < 0 || pipe(result) < 0) {
+        error("pipe");
+    }
+
+    // the child would print what is still buffered a second time
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        error("fork");
+    }
+    if (pid == 0) {
+        transport *t = bench_listen(shared_memory, port);
+        char c = 1;
+        if (write(ready[1], &c, 1) != 1) {
+            error("write");
+        }
+        if (raw) {
+            raw_receiver(t, result[1]);
+            t->close(t);
+        }
+        else {
+            stream_receiver(t, result[1]);
+        }
+        exit(0);
+    }
+
+    // the receiver must be listening before we connect, the shared memory transport refuses us otherwise
+    char c;
+    if (read(ready[0], &c, 1) != 1) {
+        error("read");
+    }
+    transport *t = bench_connect(shared_memory, port);
+
+    uint64_t start = now_usec();
+    if (raw) {
+        raw_sender(t, bytes / MSS_SIZE);
+        t->close(t);
+    }
+    else {
+        stream_sender(t, bytes);
+    }
+    *seconds = (now_usec() - start) / 1000000.0;
+
+    int64_t received = 0;
+    if (read(result[0], &received, sizeof(received)) != sizeof(received)) {
+        error("read");
+    }
+    waitpid(pid, NULL, 0);
+    close(ready[0]);
+    close(ready[1]);
+    close(result[0]);
+    close(result[1]);
+    return received;
+}
+
+// moves the same amount of data through UDP on loopback and through shared memory, first as bare packets and then as an rdt transfer
+int main(int argc, char **argv) {
+    int64_t bytes = (int64_t) (argc > 1 ? atoi(argv[1]) : BENCH_MB) << 20;
+    int port = argc > 2 ? atoi(argv[2]) : 20000 + getpid() % 10000;
+
+    for (int shared_memory = 0; shared_memory <= 1; shared_memory++) {
+        const char *name = shared_memory ? "shm" : "udp";
+        double seconds;
+
+        int64_t sent = bytes / MSS_SIZE;
+        int64_t packets = run(shared_memory, 1, port++, bytes, &seconds);
+        printf("%s raw: %.2f GB/s sent, %.1f%% of %" PRId64 " packets arrived\n", name,
+               sent * MSS_SIZE / seconds / (1 << 30), 100.0 * packets / sent, sent);
+
+        int64_t received = run(shared_memory, 0, port++, bytes, &seconds);
+        printf("%s rdt: %.3f s for %" PRId64 " MB, %.2f MB/s\n", name, seconds, received >> 20, received / seconds / (1 << 20));
+    }
+    return 0;
+}
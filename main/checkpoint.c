@@ -0,0 +1,185 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stddef.h>
+#include<string.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<libgen.h>
+#include<sys/stat.h>
+
+#include"common.h"
+#include"checksum.h"
+#include"checkpoint.h"
+
+#define HASH_CHUNK (1 << 20) //how much of the input we read at a time to hash it
+
+//derives the transfer ID from the name, size and modification time of the input, a changed file gets a new ID
+uint64_t file_transfer_id(int fd, const char * name){
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)){
+        return 0;
+    }
+
+    // the directory we were started from does not matter, only the file itself
+    char * copy = strdup(name);
+    char * base = basename(copy);
+    uint32_t name_crc = crc32c(0, base, strlen(base));
+    free(copy);
+
+    int64_t version[3] = {st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec};
+    uint64_t id = (uint64_t) name_crc << 32 | crc32c(name_crc, version, sizeof(version));
+
+    // 0 means that the transfer cannot be resumed
+    return id == 0 ? 1 : id;
+}
+
+//CRC32C of the first len bytes of the input, the sender compares it with the prefix the receiver already has
+uint32_t hash_prefix(int fd, int64_t len){
+    char * buffer = malloc(HASH_CHUNK);
+    uint32_t crc = 0;
+    int64_t offset = 0;
+
+    while (offset < len){
+        size_t want = len - offset < HASH_CHUNK ? len - offset : HASH_CHUNK;
+        ssize_t got = pread(fd, buffer, want, offset);
+        if (got < 0){
+            error("pread");
+        }
+        if (got == 0){
+            break;
+        }
+        crc = crc32c(crc, buffer, got);
+        offset += got;
+    }
+    free(buffer);
+
+    // an input shorter than the prefix cannot match it
+    return offset == len ? crc : ~crc;
+}
+
+//reads the checkpoint at path, returns 0 if there is none or it is damaged
+int load_checkpoint(const char * path, checkpoint * ckpt){
+    FILE * fp = fopen(path, "rb");
+    if (fp == NULL){
+        return 0;
+    }
+    int ok = fread(ckpt, sizeof(checkpoint), 1, fp) == 1 &&
+        ckpt->checksum == crc32c(0, ckpt, offsetof(checkpoint, checksum)) && ckpt->offset >= 0;
+    fclose(fp);
+    return ok;
+}
+
+//makes the output at fd durable up to ckpt->offset, then atomically replaces the checkpoint at path
+//everything before the offset must already have been written to fd
+void save_checkpoint(const char * path, int fd, checkpoint * ckpt){
+    // the data must reach the disk before the checkpoint that claims it does
+    if (fsync(fd) < 0){
+        error("fsync");
+    }
+    ckpt->checksum = crc32c(0, ckpt, offsetof(checkpoint, checksum));
+
+    // a crash while we write leaves the old checkpoint in place, the rename is atomic
+    char tmp[strlen(path) + 5];
+    sprintf(tmp, "%s.tmp", path);
+    int tmp_fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (tmp_fd < 0){
+        error(tmp);
+    }
+    if (write(tmp_fd, ckpt, sizeof(checkpoint)) != sizeof(checkpoint) || fsync(tmp_fd) < 0){
+        error(tmp);
+    }
+    close(tmp_fd);
+    if (rename(tmp, path) < 0){
+        error((char *) path);
+    }
+
+    // the rename itself is only durable once the directory is synced
+    char * copy = strdup(path);
+    int dir = open(dirname(copy), O_RDONLY | O_DIRECTORY);
+    if (dir >= 0){
+        fsync(dir);
+        close(dir);
+    }
+    free(copy);
+}
+
+//the transfer is complete, there is nothing left to resume
+void remove_checkpoint(const char * path){
+    unlink(path);
+}
+
+//saves the newest pending checkpoint until we stop, checkpoints that pile up meanwhile collapse into the newest one
+static void* checkpoint_thread(void * arg){
+    checkpointer * cp = arg;
+
+    pthread_mutex_lock(&cp->lock);
+    while (1){
+        if (!cp->has_pending){
+            if (cp->stop) {break;}
+            pthread_cond_wait(&cp->cond, &cp->lock);
+            continue;
+        }
+
+        checkpoint ckpt = cp->pending;
+        cp->has_pending = 0;
+        cp->busy = 1;
+        pthread_mutex_unlock(&cp->lock);
+
+        save_checkpoint(cp->path, cp->fd, &ckpt);
+
+        pthread_mutex_lock(&cp->lock);
+        cp->busy = 0;
+        pthread_cond_broadcast(&cp->cond);
+    }
+    pthread_mutex_unlock(&cp->lock);
+
+    return NULL;
+}
+
+//starts the thread that saves the checkpoints at path for the output at fd
+checkpointer * create_checkpointer(const char * path, int fd){
+    checkpointer * cp = calloc(1, sizeof(checkpointer));
+    cp->path = strdup(path);
+    cp->fd = fd;
+    pthread_mutex_init(&cp->lock, NULL);
+    pthread_cond_init(&cp->cond, NULL);
+
+    int rc = pthread_create(&cp->thread, NULL, checkpoint_thread, cp);
+    if (rc){
+        printf("ERROR: Unable to create thread %d\n", rc);
+        exit(-1);
+    }
+    return cp;
+}
+
+//hands a checkpoint to the thread without waiting for it to be saved
+void checkpoint_async(checkpointer * cp, const checkpoint * ckpt){
+    pthread_mutex_lock(&cp->lock);
+    cp->pending = *ckpt;
+    cp->has_pending = 1;
+    pthread_cond_broadcast(&cp->cond);
+    pthread_mutex_unlock(&cp->lock);
+}
+
+//waits until every checkpoint we handed over has been saved, before the output is truncated or the checkpoint removed
+void checkpoint_wait(checkpointer * cp){
+    pthread_mutex_lock(&cp->lock);
+    while (cp->has_pending || cp->busy){
+        pthread_cond_wait(&cp->cond, &cp->lock);
+    }
+    pthread_mutex_unlock(&cp->lock);
+}
+
+//saves what is still pending, then stops the thread
+void free_checkpointer(checkpointer * cp){
+    pthread_mutex_lock(&cp->lock);
+    cp->stop = 1;
+    pthread_cond_broadcast(&cp->cond);
+    pthread_mutex_unlock(&cp->lock);
+
+    pthread_join(cp->thread, NULL);
+    pthread_mutex_destroy(&cp->lock);
+    pthread_cond_destroy(&cp->cond);
+    free(cp->path);
+    free(cp);
+}
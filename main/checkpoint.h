@@ -0,0 +1,40 @@
+#ifndef CHECKPOINT_H_INCLUDED
+#define CHECKPOINT_H_INCLUDED
+#include<stdio.h>
+#include<stdint.h>
+#include<pthread.h>
+
+#define CHECKPOINT_BYTES (8 << 20) //the receiver saves a checkpoint at least every this many bytes
+#define CHECKPOINT_MS 1000 //and at least this often while bytes keep coming
+
+//what the receiver has durably written, it lives in a file next to the output so that it survives a crash
+typedef struct {
+    uint64_t transfer_id; //identifies the input the bytes came from, 0 when the transfer cannot be resumed
+    int64_t offset; //every byte before it is on disk
+    uint32_t prefix_crc; //CRC32C of the bytes before offset
+    uint32_t checksum; //CRC32C of the fields above, a torn checkpoint is ignored
+} checkpoint;
+
+//saves the checkpoints of one output on a thread of its own, so that the fsyncs never hold up the packets and their ACKs
+typedef struct {
+    char * path;
+    int fd; //the output, the receiver flushes it up to the offset of a checkpoint before it hands the checkpoint over
+    checkpoint pending; //the newest checkpoint that was not saved yet, an older one it replaced is never saved
+    int has_pending;
+    int busy; //the thread is saving a checkpoint
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t cond; //signaled when a checkpoint is pending, when one was saved and when we stop
+    pthread_t thread;
+} checkpointer;
+
+uint64_t file_transfer_id(int fd, const char * name);
+uint32_t hash_prefix(int fd, int64_t len);
+int load_checkpoint(const char * path, checkpoint * ckpt);
+void save_checkpoint(const char * path, int fd, checkpoint * ckpt);
+void remove_checkpoint(const char * path);
+checkpointer * create_checkpointer(const char * path, int fd);
+void checkpoint_async(checkpointer * cp, const checkpoint * ckpt);
+void checkpoint_wait(checkpointer * cp);
+void free_checkpointer(checkpointer * cp);
+#endif
@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "checksum.h"
+
+// the reflected CRC32C (Castagnoli) polynomial
+#define CRC32C_POLY 0x82F63B78
+
+// slicing by 8 tables for the portable version, table[0] is the classic byte at a time table
+static uint32_t table[8][256];
+
+static void init_table() {
+    for (int i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (crc & 1 ? CRC32C_POLY : 0);
+        }
+        table[0][i] = crc;
+    }
+    for (int i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+        }
+    }
+}
+
+// portable version, it consumes 8 bytes per step through the slicing tables
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char * p, size_t len) {
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        word ^= crc;
+        crc = table[7][word & 0xff] ^ table[6][(word >> 8) & 0xff] ^
+              table[5][(word >> 16) & 0xff] ^ table[4][(word >> 24) & 0xff] ^
+              table[3][(word >> 32) & 0xff] ^ table[2][(word >> 40) & 0xff] ^
+              table[1][(word >> 48) & 0xff] ^ table[0][word >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+// SSE4.2 has a CRC32C instruction, it is only called after we checked that the CPU supports it
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char * p, size_t len) {
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t) crc64;
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+// the implementation is picked once, depending on what the CPU supports
+// every thread that checksums a packet may be the first, so the choice goes through pthread_once
+static uint32_t (*crc32c_impl)(uint32_t, const unsigned char *, size_t);
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_dispatch() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32c_impl = crc32c_hw;
+        return;
+    }
+#endif
+    init_table();
+    crc32c_impl = crc32c_sw;
+}
+
+/*
+ * crc32c - extends crc (0 for a new checksum) with len bytes of data
+ */
+uint32_t crc32c(uint32_t crc, const void * data, size_t len) {
+    pthread_once(&crc32c_once, crc32c_dispatch);
+    return ~crc32c_impl(~crc, data, len);
+}
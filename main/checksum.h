@@ -0,0 +1,7 @@
+#ifndef CHECKSUM_H_INCLUDED
+#define CHECKSUM_H_INCLUDED
+#include <stdint.h>
+#include <stddef.h>
+
+uint32_t crc32c(uint32_t crc, const void * data, size_t len);
+#endif
@@ -1,16 +1,15 @@
 #include <stdio.h>
-#include <stdlib.h>
+#include <time.h>
 #include"common.h"
 
-int verbose = ALL;
+// a library that logs every packet to stderr by default would flood whatever program it is linked into
+int rdt_verbose = NONE;
+
 /*
- * error - wrapper for perror
+ * now_usec - microseconds from the monotonic clock, which never jumps with wall clock changes
  */
-void error(char *msg) {
-    perror(msg);
-    exit(1);
+uint64_t now_usec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
-
-
-
-
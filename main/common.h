@@ -1,6 +1,7 @@
 #ifndef COMMON_H_INCLUDED
 #define COMMON_H_INCLUDED
-extern int verbose;
+#include <stdint.h>
+extern int rdt_verbose; //the levels VLOG prints, NONE unless the program turns them on
 
 
 #define NONE    0x0
@@ -11,11 +12,12 @@ extern int verbose;
 #define ALL     0x111
 
 #define VLOG(level, ... ) \
-    if(level & verbose) { \
+    if(level & rdt_verbose) { \
         fprintf(stderr, ##__VA_ARGS__ );\
         fprintf(stderr, "\n");\
     }\
 
-void error(char *msg);
+void error(char *msg); //the programs' own, librdt never exits the program
+uint64_t now_usec();
 #endif
 
@@ -0,0 +1,364 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<errno.h>
+#include<time.h>
+#include<poll.h>
+#include<arpa/inet.h>
+#include<zlib.h>
+
+#include"common.h"
+#include"read_ahead.h"
+#include"compress.h"
+
+//the CPU time of the calling thread, so that we measure the cost of the codec and not the waiting
+static uint64_t thread_cpu_usec(){
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//compresses one block into a frame, a block that does not shrink is stored as it is
+static void compress_block(compressor * c, compress_slot * s){
+    char * payload = s->out + COMPRESS_FRAME_HDR;
+    uLongf len = compressBound(COMPRESS_BLOCK);
+
+    if (compress2((Bytef *) payload, &len, (const Bytef *) s->in, s->in_len, c->level) != Z_OK || len >= s->in_len){
+        memcpy(payload, s->in, s->in_len);
+        len = s->in_len;
+    }
+
+    uint32_t raw_len = htonl(s->in_len);
+    uint32_t payload_len = htonl(len);
+    memcpy(s->out, &raw_len, 4);
+    memcpy(s->out + 4, &payload_len, 4);
+    s->out_len = COMPRESS_FRAME_HDR + len;
+}
+
+//decompresses the payload of one frame, a payload as long as its block was stored as it is
+static void decompress_block(compressor * c, compress_slot * s){
+    if (s->in_len == s->out_len){
+        memcpy(s->out, s->in, s->in_len);
+        return;
+    }
+
+    uLongf len = s->out_len;
+    if (uncompress((Bytef *) s->out, &len, (const Bytef *) s->in, s->in_len) != Z_OK || len != s->out_len){
+        fprintf(stderr, "ERROR, corrupted compressed block\n");
+        exit(1);
+    }
+}
+
+//a worker takes the oldest pending block, so the block the output waits for is done first
+static void* compress_worker(void * arg){
+    compressor * c = arg;
+
+    pthread_mutex_lock(&c->lock);
+    while (1){
+        compress_slot * s = NULL;
+        for (int i = 0; i < c->num_slots && s == NULL; i++){
+            compress_slot * t = &c->slots[(c->drain + i) % c->num_slots];
+            if (t->state == SLOT_PENDING) {s = t;}
+        }
+
+        if (s == NULL){
+            if (c->stop) {break;}
+            pthread_cond_wait(&c->work_cond, &c->lock);
+            continue;
+        }
+
+        s->state = SLOT_WORKING;
+        pthread_mutex_unlock(&c->lock);
+
+        uint64_t start = thread_cpu_usec();
+        if (c->decompress){
+            decompress_block(c, s);
+        }
+        else{
+            compress_block(c, s);
+        }
+        uint64_t cpu = thread_cpu_usec() - start;
+
+        pthread_mutex_lock(&c->lock);
+        c->cpu_usec += cpu;
+        s->state = SLOT_DONE;
+        pthread_cond_broadcast(&c->done_cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    return NULL;
+}
+
+//sets up the slots and starts one worker per CPU
+static compressor * create_pool(int decompress){
+    compressor * c = calloc(1, sizeof(compressor));
+    c->decompress = decompress;
+
+    c->num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (c->num_workers < 1) {c->num_workers = 1;}
+    if (c->num_workers > COMPRESS_MAX_WORKERS) {c->num_workers = COMPRESS_MAX_WORKERS;}
+
+    // two blocks per worker, so the workers stay busy while the oldest block waits to be handed on
+    c->num_slots = 2 * c->num_workers + 1;
+    c->slots = calloc(c->num_slots, sizeof(compress_slot));
+    for (int i = 0; i < c->num_slots; i++){
+        c->slots[i].in = malloc(compressBound(COMPRESS_BLOCK) + COMPRESS_FRAME_HDR);
+        c->slots[i].out = malloc(compressBound(COMPRESS_BLOCK) + COMPRESS_FRAME_HDR);
+    }
+
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->work_cond, &cond_attr);
+    pthread_cond_init(&c->done_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    for (int i = 0; i < c->num_workers; i++){
+        int rc = pthread_create(&c->workers[i], NULL, compress_worker, c);
+        if (rc){
+            printf("ERROR: Unable to create thread %d\n", rc);
+            exit(-1);
+        }
+    }
+
+    return c;
+}
+
+//the sender's compressor, it reads blocks from source and compresses them with the given zlib level
+compressor * create_compressor(read_fn read, void * source, int level){
+    compressor * c = create_pool(0);
+    c->read = read;
+    c->source = source;
+    c->fd = read == read_fd ? *(int *) source : -1;
+    c->level = level;
+    return c;
+}
+
+//the receiver's decompressor, it hands the decompressed blocks to write in order
+compressor * create_decompressor(write_fn write, void * sink){
+    compressor * c = create_pool(1);
+    c->write = write;
+    c->sink = sink;
+    return c;
+}
+
+//waits at most timeout milliseconds for a worker to finish a block, the lock must be held
+static int wait_for_block(compressor * c, int timeout){
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += timeout * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L){
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(&c->done_cond, &c->lock, &deadline);
+}
+
+//checks if the input has data for us right now
+static int input_ready(int fd){
+    if (fd < 0){
+        return 1;
+    }
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    return poll(&pfd, 1, 0) > 0;
+}
+
+//a read_fn for the read ahead thread, it hands on the compressed frames in the order of the input
+long compress_read(void * source, char * dst, size_t len){
+    compressor * c = source;
+    size_t got = 0;
+
+    pthread_mutex_lock(&c->lock);
+    while (got < len){
+        compress_slot * s = &c->slots[c->drain];
+
+        // the oldest block is compressed, so we copy out as much of its frame as fits
+        if (s->state == SLOT_DONE){
+            size_t n = s->out_len - s->offset;
+            if (n > len - got) {n = len - got;}
+            memcpy(dst + got, s->out + s->offset, n);
+            got += n;
+            s->offset += n;
+            c->compressed_bytes += n;
+
+            if (s->offset == s->out_len){
+                s->state = SLOT_EMPTY;
+                c->drain = (c->drain + 1) % c->num_slots;
+                c->in_flight--;
+            }
+            continue;
+        }
+
+        if (c->eof && c->in_flight == 0){
+            break;
+        }
+
+        // we keep the workers busy, but we never block on a paused stream while blocks are on their way
+        compress_slot * f = &c->slots[c->fill];
+        if (!c->eof && f->state == SLOT_EMPTY && (c->in_flight == 0 || input_ready(c->fd))){
+            pthread_mutex_unlock(&c->lock);
+            long n = c->read(c->source, f->in, COMPRESS_BLOCK);
+            pthread_mutex_lock(&c->lock);
+
+            if (n < 0){
+                c->eof = 1;
+            }
+            else{
+                f->in_len = n;
+                f->offset = 0;
+                f->state = SLOT_PENDING;
+                c->fill = (c->fill + 1) % c->num_slots;
+                c->in_flight++;
+                c->raw_bytes += n;
+                pthread_cond_signal(&c->work_cond);
+            }
+            continue;
+        }
+
+        // what we already have goes out if the next block takes too long
+        if (wait_for_block(c, READ_AHEAD_FLUSH_MS) == ETIMEDOUT && got > 0){
+            break;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    return got > 0 ? (long) got : -1;
+}
+
+//writes the decompressed blocks that are done to the file, in order, the lock must be held
+static void drain_blocks(compressor * c){
+    while (c->slots[c->drain].state == SLOT_DONE){
+        compress_slot * s = &c->slots[c->drain];
+        c->write(c->sink, s->out, s->out_len);
+        c->raw_bytes += s->out_len;
+
+        s->state = SLOT_EMPTY;
+        c->drain = (c->drain + 1) % c->num_slots;
+        c->in_flight--;
+    }
+}
+
+//takes the in order bytes of the stream, cuts them into frames and hands every whole frame to the workers
+void decompress_write(void * sink, const char * data, size_t len){
+    compressor * c = sink;
+    pthread_mutex_lock(&c->lock);
+    c->compressed_bytes += len;
+
+    while (len > 0){
+        // the frame header tells us how long the payload is and how long the block will be
+        if (c->header_len < COMPRESS_FRAME_HDR){
+            size_t n = COMPRESS_FRAME_HDR - c->header_len;
+            if (n > len) {n = len;}
+            memcpy(c->header + c->header_len, data, n);
+            c->header_len += n;
+            data += n;
+            len -= n;
+
+            if (c->header_len == COMPRESS_FRAME_HDR){
+                uint32_t raw_len, payload_len;
+                memcpy(&raw_len, c->header, 4);
+                memcpy(&payload_len, c->header + 4, 4);
+                raw_len = ntohl(raw_len);
+                payload_len = ntohl(payload_len);
+                if (raw_len == 0 || raw_len > COMPRESS_BLOCK || payload_len == 0 || payload_len > compressBound(COMPRESS_BLOCK)){
+                    fprintf(stderr, "ERROR, corrupted compressed frame\n");
+                    exit(1);
+                }
+
+                // the file is written in order, so we wait until the oldest block frees its slot
+                while (c->slots[c->fill].state != SLOT_EMPTY){
+                    drain_blocks(c);
+                    if (c->slots[c->fill].state != SLOT_EMPTY){
+                        pthread_cond_wait(&c->done_cond, &c->lock);
+                    }
+                }
+
+                compress_slot * s = &c->slots[c->fill];
+                s->in_len = payload_len;
+                s->out_len = raw_len;
+                s->offset = 0;
+            }
+            continue;
+        }
+
+        compress_slot * s = &c->slots[c->fill];
+        size_t n = s->in_len - s->offset;
+        if (n > len) {n = len;}
+        memcpy(s->in + s->offset, data, n);
+        s->offset += n;
+        data += n;
+        len -= n;
+
+        // the whole payload is here, a worker can decompress it
+        if (s->offset == s->in_len){
+            s->state = SLOT_PENDING;
+            c->fill = (c->fill + 1) % c->num_slots;
+            c->in_flight++;
+            c->header_len = 0;
+            pthread_cond_signal(&c->work_cond);
+        }
+    }
+
+    drain_blocks(c);
+    pthread_mutex_unlock(&c->lock);
+}
+
+//reports the ratio, the CPU cost of the codec and the goodput of the transfer
+void compress_report(compressor * c, double elapsed){
+    double ratio = c->compressed_bytes ? (double) c->raw_bytes / c->compressed_bytes : 0;
+    double ns_per_byte = c->raw_bytes ? c->cpu_usec * 1000.0 / c->raw_bytes : 0;
+    double goodput = elapsed > 0 ? c->raw_bytes / elapsed / 1000000 : 0;
+
+    char codec[32];
+    if (c->decompress){
+        snprintf(codec, sizeof(codec), "zlib");
+    }
+    else{
+        snprintf(codec, sizeof(codec), "zlib level %d", c->level);
+    }
+
+    VLOG(INFO, "%s with %s on %d workers: %llu raw bytes, %llu on the wire, ratio %.2f, %.3f s CPU (%.2f ns/byte), goodput %.2f MB/s",
+            c->decompress ? "Decompression" : "Compression", codec, c->num_workers,
+            (unsigned long long) c->raw_bytes, (unsigned long long) c->compressed_bytes, ratio,
+            c->cpu_usec / 1000000.0, ns_per_byte, goodput);
+}
+
+//waits until the receiver has written every block that is still being decompressed
+void compress_flush(compressor * c){
+    pthread_mutex_lock(&c->lock);
+    while (c->in_flight > 0){
+        drain_blocks(c);
+        if (c->in_flight > 0){
+            pthread_cond_wait(&c->done_cond, &c->lock);
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+}
+
+//waits for the blocks still on their way, then stops the workers
+void free_compressor(compressor * c){
+    if (c->decompress){
+        compress_flush(c);
+    }
+
+    pthread_mutex_lock(&c->lock);
+    c->stop = 1;
+    pthread_cond_broadcast(&c->work_cond);
+    pthread_mutex_unlock(&c->lock);
+
+    for (int i = 0; i < c->num_workers; i++){
+        pthread_join(c->workers[i], NULL);
+    }
+
+    for (int i = 0; i < c->num_slots; i++){
+        free(c->slots[i].in);
+        free(c->slots[i].out);
+    }
+    free(c->slots);
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->work_cond);
+    pthread_cond_destroy(&c->done_cond);
+    free(c);
+}
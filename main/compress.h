@@ -0,0 +1,72 @@
+#ifndef COMPRESS_H_INCLUDED
+#define COMPRESS_H_INCLUDED
+#include<stdio.h>
+#include<stdint.h>
+#include<pthread.h>
+#include"read_ahead.h"
+
+#define COMPRESS_BLOCK (64 * 1024) //the input is compressed in independent blocks of this size
+#define COMPRESS_FRAME_HDR 8 //every block is framed by its raw length and its payload length
+#define COMPRESS_MAX_WORKERS 8 //the most worker threads of a compressor
+
+//takes the next len bytes of the receiver's stream
+typedef void (*write_fn)(void * sink, const char * data, size_t len);
+
+//the states of a block while it goes through the pipeline
+#define SLOT_EMPTY 0
+#define SLOT_PENDING 1
+#define SLOT_WORKING 2
+#define SLOT_DONE 3
+
+typedef struct {
+    int state;
+    char * in; //a raw block on the sender, a frame payload on the receiver
+    size_t in_len;
+    char * out; //a whole frame on the sender, a raw block on the receiver
+    size_t out_len;
+    size_t offset; //how much of out has already been handed on
+} compress_slot;
+
+//a pool of worker threads that (de)compresses blocks in parallel while they are handed on in order
+typedef struct {
+    int decompress; //0 on the sender, 1 on the receiver
+    int level; //the zlib level on the sender
+    read_fn read; //reads the sender's input
+    void * source;
+    int fd; //the sender's input when it is a file descriptor, -1 when it never makes us wait
+    write_fn write; //takes the receiver's decompressed blocks
+    void * sink;
+    int eof;
+    int stop;
+
+    int num_workers;
+    int num_slots;
+    compress_slot * slots;
+    int fill; //the next slot that gets a block
+    int drain; //the next slot handed on, so blocks leave in the order they came
+    int in_flight; //the slots that are not empty
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond; //signaled when a block is pending
+    pthread_cond_t done_cond; //signaled when a block is done
+    pthread_t workers[COMPRESS_MAX_WORKERS];
+
+    // receiver side frame assembly
+    char header[COMPRESS_FRAME_HDR];
+    size_t header_len;
+    size_t payload_len;
+
+    // statistics for the report
+    uint64_t raw_bytes;
+    uint64_t compressed_bytes;
+    uint64_t cpu_usec; //CPU time the workers spent (de)compressing
+} compressor;
+
+compressor * create_compressor(read_fn read, void * source, int level);
+long compress_read(void * source, char * dst, size_t len);
+compressor * create_decompressor(write_fn write, void * sink);
+void decompress_write(void * sink, const char * data, size_t len);
+void compress_flush(compressor * c);
+void compress_report(compressor * c, double elapsed);
+void free_compressor(compressor * c);
+#endif
@@ -4,6 +4,7 @@
 #include<sys/time.h>
 
 #include"create_window.h"
+#include"common.h"
 //create a buffer window with at most size 10
 window* create_window(){
     window* w = malloc(sizeof(window));
@@ -25,15 +26,15 @@ window* create_window(){
     return w;
 }
 
-//Implements insertion sorting algorithm for the rerceiver buffer
-void insert_node(window*w , node* new_node){
+//Implements insertion sorting algorithm for the rerceiver buffer, returns 0 if the packet is already buffered
+int insert_node(window*w , node* new_node){
     node* curr = w->head->next;
     while(curr != w->tail && curr->pkt_seqno < new_node->pkt_seqno){
         curr = curr->next;
     }
 
     if (curr != w->tail && curr->pkt_seqno == new_node->pkt_seqno){
-        return;
+        return 0;
     }
 
     new_node->next = curr;
@@ -41,10 +42,11 @@ void insert_node(window*w , node* new_node){
 
     curr->prev->next = new_node;
     curr->prev = new_node;
+    return 1;
 }
 
-//Adds a node to the receiver buffer
-void recv_add_node(window * w, char data[DATA_SIZE], int data_length, int pkt_seqno){
+//Adds a node to the receiver buffer, returns 0 if the packet was a duplicate and has been dropped
+int recv_add_node(window * w, char data[DATA_SIZE], int data_length, int64_t pkt_seqno){
     node* new_node = malloc(sizeof(node));
 
     memcpy(new_node->data, data, DATA_SIZE);
@@ -52,9 +54,14 @@ void recv_add_node(window * w, char data[DATA_SIZE], int data_length, int pkt_se
 
     new_node->pkt_seqno = pkt_seqno;
 
-    insert_node(w, new_node); //to implement insertion sorting
+    //to implement insertion sorting
+    if (!insert_node(w, new_node)){
+        free(new_node);
+        return 0;
+    }
 
     w->num_of_nodes++; //increment the number of nodes in the window
+    return 1;
 }
 
 //Adds a node to the sender buffer
@@ -67,9 +74,7 @@ void sender_add_node(window * w, char data[DATA_SIZE], int data_length){
     new_node->pkt_seqno = w->next_seqno;
     w->next_seqno += data_length; //this changes the next packet we are expecting for the window
 
-    struct timeval curr_time;
-    gettimeofday(&curr_time, NULL);
-    new_node->sent_time = curr_time;
+    new_node->sent_time = now_usec();
 
     // initializing default values for the node
     new_node->num_resent = 0;
@@ -94,7 +99,7 @@ void erase_node(window * w, node* n){
 }
 
 //Removes all the nodes from the sender buffer that have been acknowledged
-void remove_node(window * w, int ackno){
+void remove_node(window * w, int64_t ackno){
     node* curr = w->head->next;
     while(curr != w->tail && curr->pkt_seqno < ackno){
         curr = curr->next;
@@ -1,3 +1,5 @@
+#ifndef CREATE_WINDOW_H_INCLUDED
+#define CREATE_WINDOW_H_INCLUDED
 #include<stdio.h>
 #include<stdlib.h>
 #include<sys/time.h>
@@ -7,10 +9,10 @@
 typedef struct node {
     struct node * next;
     struct node * prev;
-    int pkt_seqno; //the sequence number of the packet
+    int64_t pkt_seqno; //the sequence number of the packet
     int data_length; //the length of the data in the packet
     char data[DATA_SIZE]; //the data in the packet
-    struct timeval sent_time; //the time the packet was sent
+    uint64_t sent_time; //the time (in microseconds of the monotonic clock) the packet was last sent
     int num_resent; //the number of times the packet has been resent
     int acked; //whether the packet has been acked or not
     int num_timeout; //the number of times the packet has timed out
@@ -20,14 +22,15 @@ typedef struct {
     node * head;
     node * tail;
     int num_of_nodes; //the number of nodes (a.k.a. packets) in the window
-    long next_seqno; //the sequence number of the next packet the window expects to get
-    long send_base; //the sequence number of the oldest unacked packet in the window
+    int64_t next_seqno; //the sequence number of the next packet the window expects to get
+    int64_t send_base; //the sequence number of the oldest unacked packet in the window
 } window;
 
 window * create_window();
-void recv_add_node(window * w, char data[DATA_SIZE], int data_length, int pkt_seqno);
+int recv_add_node(window * w, char data[DATA_SIZE], int data_length, int64_t pkt_seqno);
 void sender_add_node(window * w, char data[DATA_SIZE], int data_length);
 void erase_node(window * w, node* n);
-void remove_node(window * w, int ackno);
+void remove_node(window * w, int64_t ackno);
 void except_first(window * w);
-void free_window(window * w);
\ No newline at end of file
+void free_window(window * w);
+#endif
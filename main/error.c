@@ -0,0 +1,11 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include"common.h"
+
+/*
+ * error - wrapper for perror, it ends the program so only the programs use it and never librdt
+ */
+void error(char *msg) {
+    perror(msg);
+    exit(1);
+}
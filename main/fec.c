@@ -0,0 +1,186 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
+
+#include"fec.h"
+
+//XORs src into dst, 16 bytes at a time with SSE2 where we have it
+void fec_xor(char * dst, const char * src, int len){
+    int i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= len; i += 16){
+        __m128i a = _mm_loadu_si128((const __m128i *) (dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_xor_si128(a, b));
+    }
+#endif
+    // the portable path, and the tail that does not fill a vector
+    for (; i + 8 <= len; i += 8){
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < len; i++){
+        dst[i] ^= src[i];
+    }
+}
+
+void fec_encoder_init(fec_encoder * e, int k){
+    e->k = k;
+    fec_reset(e);
+}
+
+//starts a new group, the parity of the previous one has been sent
+void fec_reset(fec_encoder * e){
+    e->count = 0;
+    e->length = 0;
+    memset(e->parity, 0, DATA_SIZE);
+}
+
+//adds a new data packet to the group, returns 1 once the group is complete and its parity can be sent
+int fec_encode(fec_encoder * e, int64_t seqno, const char * data, int len){
+    if (e->count == 0){
+        e->start = seqno;
+    }
+    e->end = seqno + len;
+
+    // shorter packets are XORed as if they were padded with zeros
+    fec_xor(e->parity, data, len);
+    if (len > e->length) {e->length = len;}
+    e->count++;
+
+    return e->count >= e->k;
+}
+
+//the more packets we lose, the smaller the groups, so that a group rarely loses more than the one packet we can rebuild
+int fec_choose_k(float loss_rate){
+    if (loss_rate > 0.05) {return 4;}
+    if (loss_rate > 0.02) {return 8;}
+    return FEC_MAX_K;
+}
+
+void fec_history_init(fec_history * h){
+    for (int i = 0; i < FEC_HISTORY; i++){
+        h->seqno[i] = -1;
+    }
+    h->next = 0;
+}
+
+//remembers a packet that was written to the file
+void fec_history_add(fec_history * h, int64_t seqno, const char * data, int len){
+    h->seqno[h->next] = seqno;
+    h->length[h->next] = len;
+    memcpy(h->data[h->next], data, len);
+    h->next = (h->next + 1) % FEC_HISTORY;
+}
+
+void fec_groups_init(fec_groups * g){
+    for (int i = 0; i < FEC_GROUPS; i++){
+        g->start[i] = -1;
+        g->end[i] = -1;
+    }
+    g->next = 0;
+}
+
+//remembers that the parity of the group from start to end was sent
+void fec_groups_add(fec_groups * g, int64_t start, int64_t end, uint64_t sent){
+    g->start[g->next] = start;
+    g->end[g->next] = end;
+    g->sent[g->next] = sent;
+    g->next = (g->next + 1) % FEC_GROUPS;
+}
+
+//when the parity of the group holding the packet at seqno was sent, 0 if we do not know of one
+uint64_t fec_parity_sent(fec_groups * g, int64_t seqno){
+    for (int i = 0; i < FEC_GROUPS; i++){
+        if (g->start[i] <= seqno && seqno < g->end[i]){
+            return g->sent[i];
+        }
+    }
+    return 0;
+}
+
+//looks for the packet starting at seqno among the delivered and the buffered ones
+static int find_packet(fec_history * h, window * recv_window, int64_t seqno, const char ** data){
+    for (int i = 0; i < FEC_HISTORY; i++){
+        if (h->seqno[i] == seqno){
+            *data = h->data[i];
+            return h->length[i];
+        }
+    }
+
+    node * curr = recv_window->head->next;
+    while (curr != recv_window->tail && curr->pkt_seqno < seqno){
+        curr = curr->next;
+    }
+    if (curr != recv_window->tail && curr->pkt_seqno == seqno){
+        *data = curr->data;
+        return curr->data_length;
+    }
+    return 0;
+}
+
+//the first buffered packet after seqno, or -1 if there is none
+static int64_t next_buffered(window * recv_window, int64_t seqno){
+    node * curr = recv_window->head->next;
+    while (curr != recv_window->tail && curr->pkt_seqno <= seqno){
+        curr = curr->next;
+    }
+    return curr != recv_window->tail ? curr->pkt_seqno : -1;
+}
+
+//rebuilds the packet of the group that is missing when it is the only one, returns its length or 0 if nothing can be rebuilt
+int fec_recover(tcp_packet * parity, fec_history * h, window * recv_window, int64_t recv_base, char * out, int64_t * out_seqno){
+    int64_t end = parity->hdr.ackno;
+    int found = 0;
+    int missing_length = 0;
+    int64_t pos = parity->hdr.seqno;
+
+    // the whole group has already been delivered
+    if (end <= recv_base){
+        return 0;
+    }
+
+    memcpy(out, parity->data, parity->hdr.data_size);
+    memset(out + parity->hdr.data_size, 0, DATA_SIZE - parity->hdr.data_size);
+
+    while (pos < end){
+        const char * data;
+        int len = find_packet(h, recv_window, pos, &data);
+
+        if (len > 0){
+            fec_xor(out, data, len);
+            pos += len;
+            found++;
+            continue;
+        }
+
+        // a second gap means at least two packets are lost, XOR parity can only rebuild one
+        if (missing_length > 0){
+            return 0;
+        }
+
+        // the lost packet ends where the next packet we have starts
+        int64_t next = next_buffered(recv_window, pos);
+        if (next < 0 || next > end) {next = end;}
+        if (next - pos > DATA_SIZE){
+            return 0;
+        }
+
+        *out_seqno = pos;
+        missing_length = next - pos;
+        pos = next;
+    }
+
+    // a gap of one packet could still hide two short ones, the packet count tells us
+    if (missing_length == 0 || found + 1 != parity->hdr.group_size){
+        return 0;
+    }
+    return missing_length;
+}
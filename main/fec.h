@@ -0,0 +1,46 @@
+#ifndef FEC_H_INCLUDED
+#define FEC_H_INCLUDED
+#include"create_window.h"
+
+#define FEC_MAX_K 16 //the largest group of data packets protected by one parity packet
+#define FEC_HISTORY 64 //the number of delivered packets the receiver keeps to rebuild a group
+#define FEC_GROUPS 64 //the number of groups whose parity the sender remembers, enough to cover a receive window
+
+//the sender's XOR parity of the data packets of the current group
+typedef struct {
+    int k; //the number of data packets per group, it adapts to the loss rate
+    int count; //the number of data packets XORed into the parity so far
+    int64_t start; //the sequence number of the first packet of the group
+    int64_t end; //the sequence number right after the last packet of the group
+    int length; //the length of the longest packet of the group
+    char parity[DATA_SIZE];
+} fec_encoder;
+
+//the packets the receiver already wrote to the file, a group may still need them to rebuild a lost one
+typedef struct {
+    int64_t seqno[FEC_HISTORY];
+    int length[FEC_HISTORY];
+    char data[FEC_HISTORY][DATA_SIZE];
+    int next; //the entry we overwrite next
+} fec_history;
+
+//when the sender sent the parity of its latest groups, a loss in one of them may still be rebuilt by the receiver
+typedef struct {
+    int64_t start[FEC_GROUPS];
+    int64_t end[FEC_GROUPS];
+    uint64_t sent[FEC_GROUPS]; //microseconds of the monotonic clock
+    int next; //the entry we overwrite next
+} fec_groups;
+
+void fec_xor(char * dst, const char * src, int len);
+void fec_encoder_init(fec_encoder * e, int k);
+int fec_encode(fec_encoder * e, int64_t seqno, const char * data, int len);
+void fec_reset(fec_encoder * e);
+int fec_choose_k(float loss_rate);
+void fec_history_init(fec_history * h);
+void fec_history_add(fec_history * h, int64_t seqno, const char * data, int len);
+void fec_groups_init(fec_groups * g);
+void fec_groups_add(fec_groups * g, int64_t start, int64_t end, uint64_t sent);
+uint64_t fec_parity_sent(fec_groups * g, int64_t seqno);
+int fec_recover(tcp_packet * parity, fec_history * h, window * recv_window, int64_t recv_base, char * out, int64_t * out_seqno);
+#endif
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include"packet.h"
+#include"checksum.h"
 
 static tcp_packet zero_packet = {.hdr={0}};
 /*
@@ -20,3 +21,29 @@ int get_data_size(tcp_packet *pkt)
     return pkt->hdr.data_size;
 }
 
+/*
+ * set_checksum - CRC32C over the header and the data, must be the last change before the packet is sent
+ */
+void set_checksum(tcp_packet *pkt)
+{
+    pkt->hdr.checksum = 0;
+    pkt->hdr.checksum = crc32c(0, pkt, TCP_HDR_SIZE + pkt->hdr.data_size);
+}
+
+/*
+ * valid_packet - checks that the len bytes we received are one whole packet that was not corrupted on the way
+ */
+int valid_packet(tcp_packet *pkt, int len)
+{
+    if (len < (int) TCP_HDR_SIZE || pkt->hdr.data_size < 0 || pkt->hdr.data_size > (int) DATA_SIZE ||
+            len != (int) TCP_HDR_SIZE + pkt->hdr.data_size) {
+        return 0;
+    }
+
+    uint32_t checksum = pkt->hdr.checksum;
+    pkt->hdr.checksum = 0;
+    uint32_t expected = crc32c(0, pkt, len);
+    pkt->hdr.checksum = checksum;
+
+    return checksum == expected;
+}
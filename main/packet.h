@@ -1,13 +1,36 @@
+#ifndef PACKET_H_INCLUDED
+#define PACKET_H_INCLUDED
+#include <stdint.h>
+
 enum packet_type {
     DATA,
     ACK,
+    PROBE, //zero window probe, the receiver answers it with an ACK carrying its current window
+    FIN, //sent once every packet has been ACKed, marks the end of the file
+    FIN_ACK, //the receiver's answer to a FIN, after it the sender can close
+    PARITY, //XOR of a group of data packets, ackno is the end of the group and group_size the number of packets in it
+    SYN, //opens a transfer, seqno is -1 to resume wherever the receiver stopped or 0 to start over
+    SYN_ACK, //the receiver's answer to a SYN, ackno is the offset the transfer continues from
 };
 
+//the data of a SYN and a SYN_ACK
+typedef struct {
+    uint64_t transfer_id; //identifies the input, 0 when it cannot be resumed
+    uint32_t session; //random for every SYN the sender starts, repeated SYNs of a session never restart it
+    uint32_t prefix_crc; //in a SYN_ACK, CRC32C of the bytes the receiver already has
+} handshake;
+
 typedef struct {
-    int seqno;
-    int ackno;
+    int64_t seqno; //byte offset in the stream, 64 bits so that transfers past 2 GiB never wrap
+    int64_t ackno;
     int ctr_flags;
     int data_size;
+    int rwnd; //free space (in bytes) in the receiver's reassembly buffer
+    int recovered; //in an ACK, the number of packets the receiver has rebuilt from parity so far
+    int group_size; //in a PARITY, the number of data packets XORed into it
+    uint32_t tsval; //sender's monotonic clock in microseconds when the packet was sent
+    uint32_t tsecr; //tsval of the packet that triggered an ACK, echoed back so every ACK gives an RTT sample
+    uint32_t checksum; //CRC32C of the header and the data, computed with this field set to 0
 }tcp_header;
 
 #define MSS_SIZE    1500
@@ -22,3 +45,6 @@ typedef struct {
 
 tcp_packet* make_packet(int seq);
 int get_data_size(tcp_packet *pkt);
+void set_checksum(tcp_packet *pkt);
+int valid_packet(tcp_packet *pkt, int len);
+#endif
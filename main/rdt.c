@@ -0,0 +1,1322 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<errno.h>
+#include<math.h>
+#include<inttypes.h>
+#include<sys/time.h>
+#include<arpa/inet.h>
+
+#include"common.h"
+#include"create_window.h"
+#include"fec.h"
+#include"rdt.h"
+
+// defing the constants for rto calculation
+#define ALPHA 0.125
+#define BETA 0.25
+#define RTO_INIT 3000
+#define RTO_MIN 200
+#define RTO_MAX 240000
+
+// the minimum RTT is forgotten after this many milliseconds so that route changes are picked up
+#define MIN_RTT_WINDOW 10000
+
+// the tail loss probe never fires sooner than this many milliseconds
+#define TLP_MIN 10
+
+// the number of times we send the SYN or the FIN before giving up on the answer
+#define SYN_RETRIES 10
+#define FIN_RETRIES 10
+
+// the number of times in a row the oldest packet may time out before we give up on the receiver
+#define DATA_RETRIES 10
+
+// a sender that sent nothing for this many milliseconds probes the receiver, so that it does not take us for dead
+#define KEEPALIVE (RDT_IDLE_TIMEOUT / 4)
+
+// defining the different states of the congestion control
+#define SLOW_START 0
+#define CONGESTION_AVOIDANCE 1
+#define FAST_RETRANSMIT 2
+
+// what the retransmission timer does when it fires
+#define TIMER_OFF 0
+#define TIMER_RTO 1
+#define TIMER_TLP 2
+
+// the listener finds the connection of a packet in a hash table of 2^CONN_BUCKET_BITS buckets
+#define CONN_BUCKET_BITS 10
+
+//one end of a transfer, all of its state lives here so that one thread can drive many of them
+struct rdt_conn {
+    int state;
+    transport * transport; //our own on the sender, the listener's on the receiver
+    struct sockaddr_in peer; //where the listener sends to, unused on the sender
+    rdt_listener * listener; //NULL on the sender
+    uint64_t last_recv; //when (in microseconds) the last valid packet arrived
+    uint64_t last_send; //when (in microseconds) we last sent a packet
+
+    // the handshake
+    uint64_t transfer_id; //identifies the input, 0 when it cannot be resumed
+    uint32_t session_id; //random for every connection the sender opens
+    int64_t requested; //-1 if the sender asks to resume, 0 if it starts over
+    uint32_t syn_tsval; //the timestamp of the sender's latest SYN, the SYN_ACK echoes it
+    int64_t start_offset; //the sequence number the transfer starts from
+    uint32_t prefix_crc; //CRC32C of the receiver's bytes before start_offset
+    int accepted; //rdt_accept already returned the receiver's connection
+    int attached; //the listener still hands the packets of our sender to us
+    int ready; //the connection waits in the listener's ready queue
+    rdt_conn * hash_next; //the next connection in our bucket of the listener's hash table
+    rdt_conn * idle_prev; //the listener's connections in the order of their last packet
+    rdt_conn * idle_next;
+    rdt_conn * queue_next; //the next connection in the listener's accept queue, or in its ready queue once accepted
+    int syn_count; //SYNs sent so far
+    int fin_count; //FINs sent so far
+    uint64_t retry_deadline; //when the SYN or the FIN is sent again
+
+    // sender side, rdt_set_fec and rdt_set_cwnd_file set fec_enabled and cwnd_file right after rdt_connect
+    window * send_window;
+    char * send_buffer; //a ring of RDT_SEND_BUFFER bytes written but not yet in the window
+    size_t send_head;
+    size_t send_len;
+    int shutdown; //no more data will be written, the FIN follows the last byte
+    float window_size; //the congestion window in packets
+    int ss_thresh;
+    int cong_state;
+    int rto; //milliseconds
+    int rto_exp; //the RTO while we back off exponentially
+    float sample_rtt;
+    float estimated_rtt;
+    float dev_rtt;
+    float min_rtt;
+    uint64_t min_rtt_stamp;
+    int rwnd; //the receiver's advertised window in bytes
+    uint64_t last_probe; //when we last probed a zero receiver window
+    int timer; //what the retransmission timer does when it fires
+    int timer_delay; //milliseconds
+    uint64_t timer_deadline;
+    int tlp_sent; //a tail loss probe was sent since the last new ACK
+    int duplicate_ack;
+    int fec_enabled;
+    fec_encoder encoder;
+    fec_groups groups; //the groups whose parity went out, a loss in them waits for the receiver to rebuild it
+    float loss_rate;
+    int retransmitted_at_group_start;
+    int peer_recovered; //the packets the receiver rebuilt from parity, as its latest ACK reports
+    int recovered_at_group_start;
+    FILE * cwnd_file; //if set, every change of the congestion window is written to it
+
+    // receiver side
+    window * recv_window;
+    int64_t recv_base; //every byte before it was received
+    int64_t read_seqno; //every byte before it was read
+    fec_history * history;
+    int fin_received;
+    int last_window; //the window of our last ACK
+
+    // statistics
+    int packets_retransmitted;
+    int tlp_probes;
+    int parity_sent;
+    int packets_recovered;
+};
+
+//connections in the order they were queued, linked through queue_next
+typedef struct {
+    rdt_conn * head;
+    rdt_conn * tail;
+} conn_queue;
+
+//the receiver's connections share the transport of their listener, packets are handed to them by the address they come from
+//every packet and every timeout costs the same whether the listener has one connection or hundreds
+struct rdt_listener {
+    transport * transport;
+    rdt_conn * buckets[1 << CONN_BUCKET_BITS]; //the attached connections by the address of their sender
+    rdt_conn * oldest; //the attached connections by the time of their last packet, the oldest one times out first
+    rdt_conn * newest;
+    conn_queue accepting; //connections whose SYN arrived, for rdt_accept
+    conn_queue ready; //accepted connections that rdt_read has something new for, for rdt_ready
+};
+
+// function to calculate the maximum of two numbers
+static int max(int a, int b) {
+    if (a > b) {
+        return a;
+    }
+    return b;
+}
+
+//sets up a connection with the defaults of both sides
+static rdt_conn * create_conn(){
+    rdt_conn * c = calloc(1, sizeof(rdt_conn));
+
+    // window size of 1 and a 3 second RTO until the first ACK tells us more
+    c->window_size = 1.0;
+    c->ss_thresh = 64;
+    c->cong_state = SLOW_START;
+    c->rto = RTO_INIT;
+    c->rto_exp = RTO_INIT;
+    c->rwnd = DATA_SIZE;
+    c->last_window = RDT_RECV_BUFFER * DATA_SIZE;
+    c->last_recv = now_usec();
+    return c;
+}
+
+//a random session number, it tells a new connection of a sender from a repeated SYN of an old one
+static uint32_t new_session_id(){
+    static uint32_t sessions = 0;
+    sessions++;
+    return ((uint32_t) getpid() << 16) ^ (uint32_t) now_usec() ^ (sessions * 2654435761u);
+}
+
+//sends a packet we built on the stack, a packet the transport refuses is as good as lost
+static void send_raw(rdt_conn * c, tcp_packet * pkt){
+    set_checksum(pkt);
+    c->last_send = now_usec();
+    if (c->transport->send(c->transport, pkt, TCP_HDR_SIZE + pkt->hdr.data_size, c->listener != NULL ? &c->peer : NULL) < 0) {
+        VLOG(INFO, "send failed: %s", strerror(errno));
+    }
+}
+
+// main function that implements the congestion conrtrol mechanism
+static void cong_control(rdt_conn * c) {
+    // we increase the window size by 1 every ACK we receive
+    if (c->cong_state == SLOW_START) {
+        c->window_size++;
+        if (c->window_size >= c->ss_thresh) {
+            c->cong_state = CONGESTION_AVOIDANCE;
+        }
+    }
+    // we increase the window size by 1/window_size every ACK we receive after we reach the threshold
+    else if (c->cong_state == CONGESTION_AVOIDANCE) {
+        c->window_size += (float) (1.0 / (int)(c->window_size));
+    }
+
+    // we enter fast retransmit if we receive 3 duplicate ACKs
+    else if (c->cong_state == FAST_RETRANSMIT) {
+        c->ss_thresh = max( (int) (c->window_size / 2), 2);
+        c->window_size = 1;
+        c->cong_state = SLOW_START;
+    }
+
+    VLOG(INFO, "Window size is %f", c->window_size);
+
+    // writing the time, window size and threshold to the cwnd file
+    if (c->cwnd_file != NULL) {
+        struct timeval curr_time;
+        gettimeofday(&curr_time, NULL);
+        fprintf(c->cwnd_file, "%ld,%f,%d\n", curr_time.tv_sec * 1000 + curr_time.tv_usec / 1000, c->window_size, c->ss_thresh);
+    }
+}
+
+// calculates the RTO value from the timestamp echoed by an ACK, every ACK gives us a sample even for resent packets
+static void calculate_rto(rdt_conn * c, uint32_t tsecr) {
+    // ACKs that echo no timestamp carry no sample
+    if (tsecr == 0) {
+        return;
+    }
+
+    // the timestamps wrap around every 71 minutes, the unsigned difference is still the right one
+    uint64_t now = now_usec();
+    uint32_t rtt_usec = (uint32_t) now - tsecr;
+
+    // calculate the sample RTT
+    c->sample_rtt = rtt_usec / 1000.0f;
+
+    // windowed minimum filter of the RTT, an old minimum expires so that we follow path changes
+    if (c->min_rtt == 0 || c->sample_rtt <= c->min_rtt || now - c->min_rtt_stamp > MIN_RTT_WINDOW * 1000ULL) {
+        c->min_rtt = c->sample_rtt;
+        c->min_rtt_stamp = now;
+    }
+
+    // calculate the estimated RTT and the deviation RTT, the first sample initializes them as in RFC 6298
+    if (c->estimated_rtt == 0) {
+        c->estimated_rtt = c->sample_rtt;
+        c->dev_rtt = c->sample_rtt / 2;
+    }
+    else {
+        c->estimated_rtt = (1 - ALPHA) * c->estimated_rtt + ALPHA * c->sample_rtt;
+        c->dev_rtt = (1 - BETA) * c->dev_rtt + BETA * fabs(c->sample_rtt - c->estimated_rtt);
+    }
+
+    // calculate the RTO, it never fires before two minimum RTTs
+    c->rto = (int) (c->estimated_rtt + 4 * c->dev_rtt);
+    if (c->rto < 2 * c->min_rtt) {c->rto = 2 * c->min_rtt;}
+    if (c->rto < RTO_MIN) {c->rto = RTO_MIN;}
+    if (c->rto > RTO_MAX) {c->rto = RTO_MAX;}
+
+    VLOG(INFO, "RTT sample is %.3f ms, min RTT is %.3f ms, calculated RTO is %d", c->sample_rtt, c->min_rtt, c->rto);
+}
+
+//the retransmission timer fires delay milliseconds from now, rdt_tick runs what it does
+static void set_timer(rdt_conn * c, int timer, int delay){
+    c->timer = timer;
+    c->timer_delay = delay;
+    c->timer_deadline = now_usec() + delay * 1000ULL;
+}
+
+// arms the retransmission timer, once we have an RTT estimate a tail loss probe fires before the RTO
+static void arm_timer(rdt_conn * c){
+    int pto = max((int) (2 * c->estimated_rtt), TLP_MIN);
+
+    if (c->send_window->num_of_nodes == 0) {
+        c->timer = TIMER_OFF;
+    }
+    else if (c->estimated_rtt > 0 && !c->tlp_sent && pto < c->rto) {
+        set_timer(c, TIMER_TLP, pto);
+    }
+    else {
+        set_timer(c, TIMER_RTO, c->rto);
+    }
+}
+
+// sends the data of a node of the window
+static void send_node(rdt_conn * c, node * n){
+    char buffer[MSS_SIZE];
+    tcp_packet * pkt = (tcp_packet *) buffer;
+
+    memset(&pkt->hdr, 0, TCP_HDR_SIZE);
+    memcpy(pkt->data, n->data, n->data_length);
+    pkt->hdr.data_size = n->data_length;
+    pkt->hdr.seqno = n->pkt_seqno;
+    pkt->hdr.tsval = (uint32_t) now_usec();
+    send_raw(c, pkt);
+
+    n->sent_time = now_usec();
+}
+
+// sends a packet without data, a SYN also carries our handshake
+static void send_control(rdt_conn * c, int flags, int64_t seqno){
+    char buffer[MSS_SIZE];
+    tcp_packet * pkt = (tcp_packet *) buffer;
+
+    memset(&pkt->hdr, 0, TCP_HDR_SIZE);
+    pkt->hdr.seqno = seqno;
+    pkt->hdr.ctr_flags = flags;
+    pkt->hdr.tsval = (uint32_t) now_usec();
+    if (flags == SYN) {
+        handshake info = {.transfer_id = c->transfer_id, .session = c->session_id};
+        memcpy(pkt->data, &info, sizeof(handshake));
+        pkt->hdr.data_size = sizeof(handshake);
+    }
+    send_raw(c, pkt);
+}
+
+// we resend the oldest packet if it is not ACKed within the RTO
+static void resend_packets(rdt_conn * c){
+    VLOG(INFO, "Timeout happened");
+
+    node * curr = c->send_window->head->next;
+
+    // filter to check if the window is empty
+    if (curr == c->send_window->tail) {
+        VLOG(INFO, "No packets to resend");
+        return;
+    }
+
+    // no ACK moved the window through all of these timeouts, the receiver is gone
+    if (curr->num_timeout >= DATA_RETRIES) {
+        VLOG(INFO, "Packet with seqno %" PRId64 " timed out %d times, giving up", curr->pkt_seqno, DATA_RETRIES);
+        c->state = RDT_FAILED;
+        return;
+    }
+
+    send_node(c, curr);
+
+    // resending the packet, so we increase the counter
+    curr->num_resent++;
+    c->packets_retransmitted++;
+
+    // we also record the number of times the packet has timed out
+    curr->num_timeout++;
+
+    // since timeout indicates a packet loss, we enter fast retransmit
+    c->cong_state = FAST_RETRANSMIT;
+    cong_control(c);
+
+    // we are preserving the rto value so that we can use it for other packets that are not experiencing exponential backoff
+    if (curr->num_timeout == 1) {
+        c->rto_exp = c->rto;
+    }
+    else {
+        // we double the rto value after we experience two successive timeouts
+        c->rto_exp *= 2;
+        if (c->rto_exp > RTO_MAX) {c->rto_exp = RTO_MAX;}
+
+        VLOG(INFO, "Exponential backoff: RTO is %d", c->rto_exp);
+    }
+
+    set_timer(c, TIMER_RTO, c->rto_exp);
+
+    VLOG(INFO, "Resent packet with seqno %" PRId64, curr->pkt_seqno);
+}
+
+// we resend the oldest packet if we receive 3 duplicate ACKs
+static void resend_duplicate_packets(rdt_conn * c){
+    VLOG(INFO, "Duplicate ACK Detected!");
+
+    node * curr = c->send_window->head->next;
+
+    // filter to check if the window is empty
+    if (curr == c->send_window->tail) {
+        VLOG(INFO, "No packets to resend");
+        return;
+    }
+
+    // resending the packet, so we increase the counter
+    curr->num_resent++;
+    c->packets_retransmitted++;
+
+    // 3 duplicate ACKs indicate a packet loss, so we enter fast retransmit
+    c->cong_state = FAST_RETRANSMIT;
+    cong_control(c);
+
+    send_node(c, curr);
+
+    VLOG(INFO, "Resent packet with seqno %" PRId64, curr->pkt_seqno);
+}
+
+// when no ACK arrives for about two RTTs we resend the last packet, its ACK reveals a lost tail without waiting for the RTO
+static void tail_loss_probe(rdt_conn * c){
+    node * last = c->send_window->tail->prev;
+
+    // filter to check if the window is empty
+    if (last == c->send_window->head) {
+        return;
+    }
+
+    send_node(c, last);
+
+    last->num_resent++;
+    c->tlp_sent = 1;
+    c->tlp_probes++;
+
+    // a probe is not a loss yet, so the window is left alone and the RTO takes over if the probe is not ACKed either
+    set_timer(c, TIMER_RTO, c->rto);
+
+    VLOG(INFO, "Tail loss probe, resent packet with seqno %" PRId64, last->pkt_seqno);
+}
+
+// sends the parity of the current FEC group, the receiver rebuilds a single lost packet of the group from it
+static void send_parity(rdt_conn * c) {
+    char buffer[MSS_SIZE];
+    tcp_packet * pkt = (tcp_packet *) buffer;
+    fec_encoder * e = &c->encoder;
+
+    memset(&pkt->hdr, 0, TCP_HDR_SIZE);
+    memcpy(pkt->data, e->parity, e->length);
+    pkt->hdr.data_size = e->length;
+    pkt->hdr.seqno = e->start;
+    pkt->hdr.ackno = e->end;
+    pkt->hdr.group_size = e->count;
+    pkt->hdr.ctr_flags = PARITY;
+    pkt->hdr.tsval = (uint32_t) now_usec();
+    send_raw(c, pkt);
+    c->parity_sent++;
+
+    fec_groups_add(&c->groups, e->start, e->end, now_usec());
+
+    // the share of packets we lost while this group was sent, smoothed over the groups
+    // the packets the receiver rebuilt count as well, otherwise working FEC would hide the loss it repairs
+    int lost = c->packets_retransmitted - c->retransmitted_at_group_start + c->peer_recovered - c->recovered_at_group_start;
+    float group_loss = (float) lost / e->count;
+    c->loss_rate = 0.75 * c->loss_rate + 0.25 * group_loss;
+    c->retransmitted_at_group_start = c->packets_retransmitted;
+    c->recovered_at_group_start = c->peer_recovered;
+
+    VLOG(INFO, "Sent parity for %d packets from seqno %" PRId64 ", loss rate is %f", e->count, e->start, c->loss_rate);
+
+    // the next group is smaller when we lose more
+    fec_encoder_init(e, fec_choose_k(c->loss_rate));
+}
+
+// with FEC the receiver may still rebuild the oldest unACKed packet from its group's parity
+// until it had an RTT to do so, a fast retransmit would only collapse the window for a packet that is not lost
+static int fec_may_repair(rdt_conn * c) {
+    int64_t seqno = c->send_window->send_base;
+    if (!c->fec_enabled) {
+        return 0;
+    }
+
+    // the group is still open, so its parity goes out now instead of after the rest of the group
+    if (c->encoder.count > 0 && seqno >= c->encoder.start) {
+        send_parity(c);
+    }
+
+    uint64_t sent = fec_parity_sent(&c->groups, seqno);
+    return sent != 0 && now_usec() - sent < (uint64_t) ((c->estimated_rtt + 2 * c->dev_rtt) * 1000);
+}
+
+// checks if the receiver has room for one more packet beyond the ones already in flight
+static int rwnd_allows(rdt_conn * c) {
+    return c->send_window->next_seqno - c->send_window->send_base + DATA_SIZE <= c->rwnd;
+}
+
+// moves the written bytes into the window as long as the congestion window and the receiver's window allow it
+static void pump(rdt_conn * c){
+    if (c->state != RDT_ESTABLISHED || c->listener != NULL) {
+        return;
+    }
+    window * w = c->send_window;
+
+    while (c->send_len > 0) {
+        // limit the number of packets in the window to the window size and the receiver's window
+        if (w->num_of_nodes > (int) c->window_size) {
+            break;
+        }
+        if (!rwnd_allows(c)) {
+            // the receiver window is closed and nothing is in flight to bring us a new one, so we probe it every RTO
+            if (w->num_of_nodes == 0 && now_usec() - c->last_probe >= c->rto * 1000ULL) {
+                send_control(c, PROBE, w->next_seqno);
+                c->last_probe = now_usec();
+                VLOG(INFO, "Sent window probe, receiver window is %d", c->rwnd);
+            }
+            break;
+        }
+
+        // a short packet waits for the ACKs of what is in flight, the writer may still fill it up
+        if (c->send_len < DATA_SIZE && w->num_of_nodes > 0 && !c->shutdown) {
+            break;
+        }
+
+        char data[DATA_SIZE];
+        int len = c->send_len < DATA_SIZE ? c->send_len : DATA_SIZE;
+        size_t first = RDT_SEND_BUFFER - c->send_head;
+        if (first > (size_t) len) {first = len;}
+        memcpy(data, c->send_buffer + c->send_head, first);
+        memcpy(data + first, c->send_buffer, len - first);
+        c->send_head = (c->send_head + len) % RDT_SEND_BUFFER;
+        c->send_len -= len;
+
+        // create a packet, add it to the window and send it
+        sender_add_node(w, data, len);
+        send_node(c, w->tail->prev);
+        VLOG(INFO, "Sent packet with seqno %" PRId64, w->tail->prev->pkt_seqno);
+
+        // XOR it into the parity of its FEC group, the parity goes out right after the last packet of the group
+        if (c->fec_enabled && fec_encode(&c->encoder, w->tail->prev->pkt_seqno, w->tail->prev->data, len)) {
+            send_parity(c);
+        }
+
+        // start the timer if this is the only packet in the window, otherwise the ACKs restart it
+        if (w->num_of_nodes == 1) {
+            arm_timer(c);
+        }
+    }
+
+    if (!c->shutdown || c->send_len > 0) {
+        return;
+    }
+
+    // the last group is protected as well, even if it is not complete
+    if (c->fec_enabled && c->encoder.count > 1) {
+        send_parity(c);
+    }
+
+    // the FIN goes out once every packet has been ACKed, we repeat it every RTO until the receiver ACKs it
+    if (c->fin_count == 0 && w->send_base == w->next_seqno) {
+        VLOG(INFO, "End of File Reached, sent %d tail loss probes", c->tlp_probes);
+        VLOG(INFO, "Retransmitted %d packets, sent %d parity packets", c->packets_retransmitted, c->parity_sent);
+        VLOG(INFO, "Sending FIN");
+        send_control(c, FIN, w->next_seqno);
+        c->fin_count = 1;
+        c->retry_deadline = now_usec() + c->rto * 1000ULL;
+    }
+}
+
+// the sender's side of an ACK, it slides the window and drives the retransmissions
+static void receive_ack(rdt_conn * c, tcp_packet * pkt){
+    window * w = c->send_window;
+
+    // the receiver accepted our SYN, the transfer continues from the offset it gave us
+    if (pkt->hdr.ctr_flags == SYN_ACK) {
+        handshake info;
+        if (c->state != RDT_SYN_SENT || pkt->hdr.data_size != sizeof(handshake) || pkt->hdr.ackno < 0) {
+            return;
+        }
+        memcpy(&info, pkt->data, sizeof(handshake));
+
+        // a late SYN_ACK of an earlier session does not answer this SYN
+        if (info.session != c->session_id) {
+            return;
+        }
+        c->start_offset = pkt->hdr.ackno;
+        c->prefix_crc = info.prefix_crc;
+        w->next_seqno = c->start_offset;
+        w->send_base = c->start_offset;
+
+        // the SYN_ACK gives us the first RTT sample and window
+        calculate_rto(c, pkt->hdr.tsecr);
+        c->rwnd = pkt->hdr.rwnd;
+        c->state = RDT_ESTABLISHED;
+        VLOG(INFO, "Transfer %016" PRIx64 " established at offset %" PRId64, c->transfer_id, c->start_offset);
+        pump(c);
+        return;
+    }
+
+    // the receiver has the whole file, so we can close the connection
+    if (pkt->hdr.ctr_flags == FIN_ACK) {
+        if (c->fin_count > 0) {
+            VLOG(INFO, "Received FIN_ACK");
+            c->state = RDT_CLOSED;
+            c->timer = TIMER_OFF;
+        }
+        return;
+    }
+
+    // an ACK of data we never sent is bogus
+    if (c->state != RDT_ESTABLISHED || pkt->hdr.ackno > w->next_seqno) {
+        return;
+    }
+
+    VLOG(INFO, "Received ACK for packet with seqno %" PRId64 " from packet %" PRId64, pkt->hdr.ackno, pkt->hdr.seqno);
+
+    // if we receive an ACK it means that a packet was received successfully
+    cong_control(c);
+
+    // every ACK echoes the timestamp of the packet that triggered it, including duplicates and ACKs of resent packets
+    calculate_rto(c, pkt->hdr.tsecr);
+
+    // only ACKs that do not go backwards can update the receiver window, older ones may carry a stale window
+    if (pkt->hdr.ackno >= w->send_base) {
+        c->rwnd = pkt->hdr.rwnd;
+    }
+    if (pkt->hdr.recovered > c->peer_recovered) {
+        c->peer_recovered = pkt->hdr.recovered;
+    }
+
+    // we received the oldest unACKed packet, so we update the send_base
+    if (pkt->hdr.ackno > w->send_base) {
+        w->send_base = pkt->hdr.ackno;
+
+        // we remove all the packets that have been cumulatively ACKed
+        remove_node(w, pkt->hdr.ackno);
+
+        // we restart the timer for the oldest unACKed packet, the new ACK allows another tail loss probe
+        // the duplicates we counted were about the packet that is ACKed now
+        c->tlp_sent = 0;
+        c->duplicate_ack = 0;
+        arm_timer(c);
+    }
+
+    // if we receive a duplicate ACK, we increment the duplicate ACK counter
+    if (pkt->hdr.ackno < pkt->hdr.seqno) {
+        c->duplicate_ack++;
+    }
+
+    // if we receive 3 duplicate ACKs, we resend the packet and restart the timer, unless FEC may still repair it
+    if (c->duplicate_ack >= 3 && !fec_may_repair(c)) {
+        VLOG(INFO, "Duplicate ACK received");
+        c->duplicate_ack = 0;
+        resend_duplicate_packets(c);
+        arm_timer(c);
+    }
+
+    // the window may have space again, or the transfer may be complete
+    pump(c);
+}
+
+// the free space in the reassembly buffer that we advertise to the sender
+static int advertised_window(rdt_conn * c) {
+    return max(RDT_RECV_BUFFER - c->recv_window->num_of_nodes, 0) * DATA_SIZE;
+}
+
+// sends a cumulative ACK (or a FIN_ACK, or a SYN_ACK) with the current receive base and our advertised window
+static void send_ack(rdt_conn * c, int flags, int64_t seqno, uint32_t tsecr) {
+    char buffer[MSS_SIZE];
+    tcp_packet * pkt = (tcp_packet *) buffer;
+
+    memset(&pkt->hdr, 0, TCP_HDR_SIZE);
+    pkt->hdr.ackno = c->recv_base;
+
+    // we record the sequence number of the packet that we received, so that the client knows which packet is ACKing
+    pkt->hdr.seqno = seqno;
+    pkt->hdr.ctr_flags = flags;
+    pkt->hdr.rwnd = advertised_window(c);
+    pkt->hdr.recovered = c->packets_recovered;
+    c->last_window = pkt->hdr.rwnd;
+
+    // echoing the timestamp of the packet we are ACKing so that the sender can measure the RTT
+    pkt->hdr.tsecr = tsecr;
+
+    // the SYN_ACK tells the sender which transfer we continue and what we already have
+    if (flags == SYN_ACK) {
+        handshake info = {.transfer_id = c->transfer_id, .session = c->session_id, .prefix_crc = c->prefix_crc};
+        memcpy(pkt->data, &info, sizeof(handshake));
+        pkt->hdr.data_size = sizeof(handshake);
+    }
+    send_raw(c, pkt);
+}
+
+//appends c to q
+static void queue_push(conn_queue * q, rdt_conn * c){
+    c->queue_next = NULL;
+    if (q->tail != NULL) {
+        q->tail->queue_next = c;
+    }
+    else {
+        q->head = c;
+    }
+    q->tail = c;
+}
+
+//takes the first connection off q, NULL if it is empty
+static rdt_conn * queue_pop(conn_queue * q){
+    rdt_conn * c = q->head;
+    if (c != NULL) {
+        q->head = c->queue_next;
+        if (q->head == NULL) {q->tail = NULL;}
+    }
+    return c;
+}
+
+//takes c out of the middle of q, only closing a connection does that so we walk the queue
+static void queue_remove(conn_queue * q, rdt_conn * c){
+    rdt_conn * prev = NULL;
+    rdt_conn * curr = q->head;
+    while (curr != NULL && curr != c) {
+        prev = curr;
+        curr = curr->queue_next;
+    }
+    if (curr == NULL) {
+        return;
+    }
+    if (prev != NULL) {
+        prev->queue_next = c->queue_next;
+    }
+    else {
+        q->head = c->queue_next;
+    }
+    if (q->tail == c) {q->tail = prev;}
+}
+
+//the bucket of the listener's hash table that the connection of the sender at addr is in
+static rdt_conn ** conn_bucket(rdt_listener * l, struct sockaddr_in * addr){
+    uint32_t key = addr->sin_addr.s_addr ^ ((uint32_t) addr->sin_port << 16) ^ addr->sin_port;
+    return &l->buckets[(key * 2654435761u) >> (32 - CONN_BUCKET_BITS)];
+}
+
+//takes c out of the list of connections by their last packet
+static void unlink_idle(rdt_listener * l, rdt_conn * c){
+    if (c->idle_prev != NULL) {c->idle_prev->idle_next = c->idle_next;}
+    else {l->oldest = c->idle_next;}
+    if (c->idle_next != NULL) {c->idle_next->idle_prev = c->idle_prev;}
+    else {l->newest = c->idle_prev;}
+    c->idle_prev = NULL;
+    c->idle_next = NULL;
+}
+
+//puts c at the end of the list of connections by their last packet, it is the last one to time out
+static void append_idle(rdt_listener * l, rdt_conn * c){
+    c->idle_prev = l->newest;
+    c->idle_next = NULL;
+    if (l->newest != NULL) {
+        l->newest->idle_next = c;
+    }
+    else {
+        l->oldest = c;
+    }
+    l->newest = c;
+}
+
+//c just got a packet
+static void touch_conn(rdt_listener * l, rdt_conn * c){
+    if (l->newest != c) {
+        unlink_idle(l, c);
+        append_idle(l, c);
+    }
+}
+
+//the listener hands the packets of c's sender to c from now on
+static void attach_conn(rdt_listener * l, rdt_conn * c){
+    rdt_conn ** bucket = conn_bucket(l, &c->peer);
+    c->hash_next = *bucket;
+    *bucket = c;
+    c->attached = 1;
+    append_idle(l, c);
+}
+
+//the listener stops handing packets to c
+static void detach_conn(rdt_listener * l, rdt_conn * c){
+    if (!c->attached) {
+        return;
+    }
+    rdt_conn ** p = conn_bucket(l, &c->peer);
+    while (*p != c) {
+        p = &(*p)->hash_next;
+    }
+    *p = c->hash_next;
+    unlink_idle(l, c);
+    c->attached = 0;
+}
+
+//rdt_ready returns c once, however many packets arrived for it until then
+static void mark_ready(rdt_conn * c){
+    if (c->accepted && !c->ready) {
+        c->ready = 1;
+        queue_push(&c->listener->ready, c);
+    }
+}
+
+//the receiver's connection is over, rdt_read tells its reader why
+//a connection that was never accepted waits in the accept queue, rdt_accept frees it
+static void end_conn(rdt_conn * c, int state){
+    c->state = state;
+    detach_conn(c->listener, c);
+    mark_ready(c);
+}
+
+// moves the receive base over the packets that are now in order, they stay buffered until they are read
+static void deliver(rdt_conn * c) {
+    node * curr = c->recv_window->head->next;
+    while (curr != c->recv_window->tail && curr->pkt_seqno < c->recv_base) {
+        curr = curr->next;
+    }
+
+    // checks if the seqno of the current packet matches the receive base, if it does it means that the packet is in order
+    while (curr != c->recv_window->tail && curr->pkt_seqno == c->recv_base) {
+        fec_history_add(c->history, curr->pkt_seqno, curr->data, curr->data_length);
+        c->recv_base += curr->data_length;
+        curr = curr->next;
+        mark_ready(c);
+    }
+}
+
+// the receiver's side of a packet
+static void receive_data(rdt_conn * c, tcp_packet * pkt){
+    // a repeated SYN of our sender, our SYN_ACK got lost
+    if (pkt->hdr.ctr_flags == SYN) {
+        c->syn_tsval = pkt->hdr.tsval;
+        if (c->state == RDT_ESTABLISHED) {
+            send_ack(c, SYN_ACK, pkt->hdr.seqno, pkt->hdr.tsval);
+        }
+        return;
+    }
+
+    // until rdt_start we do not know where the data belongs
+    if (c->state != RDT_ESTABLISHED) {
+        return;
+    }
+
+    // the sender probes us when our advertised window was zero, we answer with the current window
+    if (pkt->hdr.ctr_flags == PROBE) {
+        VLOG(INFO, "Window probe received");
+        send_ack(c, ACK, c->recv_base, pkt->hdr.tsval);
+        return;
+    }
+
+    // a parity packet rebuilds the one packet its group lost, so we do not wait a round trip for the retransmission
+    if (pkt->hdr.ctr_flags == PARITY) {
+        char recovered[DATA_SIZE];
+        int64_t recovered_seqno;
+        int recovered_len = c->fin_received ? 0 : fec_recover(pkt, c->history, c->recv_window, c->recv_base, recovered, &recovered_seqno);
+
+        if (recovered_len > 0 && recovered_seqno >= c->recv_base && recv_add_node(c->recv_window, recovered, recovered_len, recovered_seqno)) {
+            c->packets_recovered++;
+            VLOG(INFO, "Recovered packet %" PRId64 " from parity, %d recovered so far", recovered_seqno, c->packets_recovered);
+
+            deliver(c);
+            send_ack(c, ACK, recovered_seqno, pkt->hdr.tsval);
+        }
+        return;
+    }
+
+    // the FIN marks the end of the file, we only accept it once everything before it has been received
+    if (pkt->hdr.ctr_flags == FIN && pkt->hdr.seqno == c->recv_base) {
+        send_ack(c, FIN_ACK, pkt->hdr.seqno, pkt->hdr.tsval);
+        if (!c->fin_received) {
+            VLOG(INFO, "End Of File has been reached");
+            c->fin_received = 1;
+            mark_ready(c);
+        }
+        return;
+    }
+
+    // the stream has ended, anything but a FIN is a stale retransmission
+    if (c->fin_received || pkt->hdr.ctr_flags == FIN) {
+        send_ack(c, ACK, pkt->hdr.seqno, pkt->hdr.tsval);
+        return;
+    }
+
+    struct timeval tp;
+    gettimeofday(&tp, NULL);
+    VLOG(DEBUG, "%lu, %d, %" PRId64, tp.tv_sec, pkt->hdr.data_size, pkt->hdr.seqno);
+
+    // the buffer is full, but the packet at the receive base still gets in in place of the last out of order one
+    // that one is sent again later, while without the packet at the receive base nothing in the buffer could ever be read
+    node * last = c->recv_window->tail->prev;
+    if (pkt->hdr.seqno == c->recv_base && c->recv_window->num_of_nodes >= RDT_RECV_BUFFER && last != c->recv_window->head && last->pkt_seqno > c->recv_base) {
+        VLOG(INFO, "Evicted out of order packet %" PRId64 " for the packet at the receive base", last->pkt_seqno);
+        erase_node(c->recv_window, last);
+    }
+
+    // the packet is less than the receive base which means that it is a duplicate packet
+    if (pkt->hdr.seqno < c->recv_base) {
+        send_ack(c, ACK, pkt->hdr.seqno, pkt->hdr.tsval);
+    }
+    // the packet does not fit into the reassembly buffer, so we drop it and repeat our window
+    // the ACK names the receive base, so the sender does not take a drop for flow control as a loss
+    else if (pkt->hdr.seqno >= c->read_seqno + RDT_RECV_BUFFER * DATA_SIZE || c->recv_window->num_of_nodes >= RDT_RECV_BUFFER) {
+        VLOG(INFO, "Dropped packet %" PRId64 " outside of the receive window", pkt->hdr.seqno);
+        send_ack(c, ACK, c->recv_base, pkt->hdr.tsval);
+    }
+    else {
+        // we buffer the packet and move the receive base over what is in order now
+        recv_add_node(c->recv_window, pkt->data, pkt->hdr.data_size, pkt->hdr.seqno);
+        deliver(c);
+
+        // sending cumulative acks
+        send_ack(c, ACK, pkt->hdr.seqno, pkt->hdr.tsval);
+    }
+
+    VLOG(INFO, "Window Size: %d, Recv Base: %" PRId64, c->recv_window->num_of_nodes, c->recv_base);
+}
+
+//hands a packet that passed its checksum to its connection
+static void rdt_input(rdt_conn * c, tcp_packet * pkt){
+    c->last_recv = now_usec();
+    if (c->listener == NULL) {
+        receive_ack(c, pkt);
+    }
+    else {
+        touch_conn(c->listener, c);
+        receive_data(c, pkt);
+    }
+}
+
+//finds the connection of the sender at addr
+static rdt_conn * find_conn(rdt_listener * l, struct sockaddr_in * addr){
+    rdt_conn * c = *conn_bucket(l, addr);
+    while (c != NULL && (c->peer.sin_addr.s_addr != addr->sin_addr.s_addr || c->peer.sin_port != addr->sin_port)) {
+        c = c->hash_next;
+    }
+    return c;
+}
+
+//frees the connection and everything it holds
+static void free_conn(rdt_conn * c){
+    if (c->send_window != NULL) {free_window(c->send_window);}
+    if (c->recv_window != NULL) {free_window(c->recv_window);}
+    free(c->send_buffer);
+    free(c->history);
+    free(c);
+}
+
+//reads every packet waiting on the listener's transport and hands it to its connection, a SYN of a new session opens a new one
+static void listener_receive(rdt_listener * l){
+    char buffer[MSS_SIZE];
+
+    while (1) {
+        struct sockaddr_in addr;
+        int len = l->transport->recv(l->transport, buffer, MSS_SIZE, &addr);
+        if (len < 0) {
+            return;
+        }
+        tcp_packet * pkt = (tcp_packet *) buffer;
+
+        // corrupted or truncated packets never reach a connection, the sender resends them as if they were lost
+        if (!valid_packet(pkt, len)) {
+            VLOG(INFO, "Dropped corrupted packet");
+            continue;
+        }
+
+        rdt_conn * c = find_conn(l, &addr);
+        if (pkt->hdr.ctr_flags == SYN && pkt->hdr.data_size == sizeof(handshake)) {
+            handshake info;
+            memcpy(&info, pkt->data, sizeof(handshake));
+
+            // a repeated SYN of the session we already have
+            if (c != NULL && c->session_id == info.session) {
+                rdt_input(c, pkt);
+                continue;
+            }
+
+            // the sender started over, its old connection is dead
+            if (c != NULL) {
+                end_conn(c, RDT_RESET);
+            }
+
+            c = create_conn();
+            c->transport = l->transport;
+            c->peer = addr;
+            c->listener = l;
+            c->state = RDT_SYN_RECEIVED;
+            c->transfer_id = info.transfer_id;
+            c->session_id = info.session;
+            c->requested = pkt->hdr.seqno;
+            c->syn_tsval = pkt->hdr.tsval;
+            c->recv_window = create_window();
+            c->history = malloc(sizeof(fec_history));
+            fec_history_init(c->history);
+
+            attach_conn(l, c);
+            queue_push(&l->accepting, c);
+            VLOG(INFO, "SYN for transfer %016" PRIx64 " from %s:%d", c->transfer_id, inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+            continue;
+        }
+
+        // until a sender opened a connection we do not know where its data belongs
+        if (c == NULL) {
+            VLOG(INFO, "Dropped packet before the SYN");
+            continue;
+        }
+        rdt_input(c, pkt);
+    }
+}
+
+//reads every packet waiting on the sender's transport
+static void conn_receive(rdt_conn * c){
+    char buffer[MSS_SIZE];
+
+    while (1) {
+        int len = c->transport->recv(c->transport, buffer, MSS_SIZE, NULL);
+        if (len < 0) {
+            return;
+        }
+        tcp_packet * pkt = (tcp_packet *) buffer;
+
+        // a corrupted ACK is dropped as if it had been lost
+        if (!valid_packet(pkt, len)) {
+            VLOG(INFO, "Dropped corrupted ACK");
+            continue;
+        }
+        rdt_input(c, pkt);
+    }
+}
+
+//opens a transfer over t, which connects us to the receiver and belongs to the connection from now on
+//resume asks the receiver to continue where it stopped, the SYN goes out right away
+rdt_conn * rdt_connect(transport * t, uint64_t transfer_id, int resume){
+    rdt_conn * c = create_conn();
+    c->transport = t;
+
+    c->send_window = create_window();
+    c->send_buffer = malloc(RDT_SEND_BUFFER);
+    fec_encoder_init(&c->encoder, FEC_MAX_K);
+    fec_groups_init(&c->groups);
+
+    c->transfer_id = transfer_id;
+    c->session_id = new_session_id();
+    c->requested = resume ? -1 : 0;
+    c->state = RDT_SYN_SENT;
+
+    VLOG(INFO, "Sending SYN for transfer %016" PRIx64, c->transfer_id);
+    send_control(c, SYN, c->requested);
+    c->syn_count = 1;
+    c->retry_deadline = now_usec() + c->rto * 1000ULL;
+    return c;
+}
+
+//the receiver's connections share the transport t, which belongs to the listener from now on
+rdt_listener * rdt_listen(transport * t){
+    rdt_listener * l = calloc(1, sizeof(rdt_listener));
+    l->transport = t;
+    return l;
+}
+
+//returns a connection whose SYN arrived, NULL if there is none, the caller answers it with rdt_start
+rdt_conn * rdt_accept(rdt_listener * l){
+    rdt_conn * c;
+    while ((c = queue_pop(&l->accepting)) != NULL) {
+        // the sender started over or went quiet before anyone took its connection
+        if (c->state != RDT_SYN_RECEIVED) {
+            free_conn(c);
+            continue;
+        }
+        c->accepted = 1;
+        return c;
+    }
+    return NULL;
+}
+
+//returns an accepted connection that rdt_read has something new for, NULL if there is none
+//a connection is returned once for everything that arrived since, so its reader reads it until rdt_read fails with EAGAIN
+rdt_conn * rdt_ready(rdt_listener * l){
+    rdt_conn * c = queue_pop(&l->ready);
+    if (c != NULL) {
+        c->ready = 0;
+    }
+    return c;
+}
+
+//answers the SYN, the transfer continues at offset and prefix_crc is the CRC32C of the bytes before it
+void rdt_start(rdt_conn * c, int64_t offset, uint32_t prefix_crc){
+    c->start_offset = offset;
+    c->recv_base = offset;
+    c->read_seqno = offset;
+    c->prefix_crc = prefix_crc;
+    c->state = RDT_ESTABLISHED;
+
+    VLOG(INFO, "Transfer %016" PRIx64 " starts at offset %" PRId64, c->transfer_id, offset);
+    send_ack(c, SYN_ACK, c->requested, c->syn_tsval);
+}
+
+//takes as much of data as fits into the send buffer, -1 with EAGAIN if nothing does
+long rdt_write(rdt_conn * c, const char * data, size_t len){
+    if (c->shutdown || c->state == RDT_FAILED || c->state == RDT_RESET || c->state == RDT_CLOSED) {
+        errno = EPIPE;
+        return -1;
+    }
+
+    size_t n = RDT_SEND_BUFFER - c->send_len;
+    if (n > len) {n = len;}
+    if (n == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    size_t tail = (c->send_head + c->send_len) % RDT_SEND_BUFFER;
+    size_t first = RDT_SEND_BUFFER - tail;
+    if (first > n) {first = n;}
+    memcpy(c->send_buffer + tail, data, first);
+    memcpy(c->send_buffer, data + first, n - first);
+    c->send_len += n;
+
+    pump(c);
+    return n;
+}
+
+//no more data follows, the FIN goes out once everything written was ACKed
+void rdt_shutdown(rdt_conn * c){
+    c->shutdown = 1;
+    pump(c);
+}
+
+//copies in order bytes into dst, returns 0 at the end of the stream and -1 with EAGAIN if nothing arrived yet
+//-1 with ECONNRESET once the sender opened a new connection, what this one still holds is sent again on that one
+//-1 with ETIMEDOUT once everything was read from a sender that went quiet for RDT_IDLE_TIMEOUT
+long rdt_read(rdt_conn * c, char * dst, size_t len){
+    window * w = c->recv_window;
+    node * curr = w->head->next;
+    size_t got = 0;
+
+    if (c->state == RDT_RESET) {
+        errno = ECONNRESET;
+        return -1;
+    }
+
+    while (got < len && curr != w->tail && curr->pkt_seqno < c->recv_base) {
+        int offset = c->read_seqno - curr->pkt_seqno;
+        size_t n = curr->data_length - offset;
+        if (n > len - got) {n = len - got;}
+        memcpy(dst + got, curr->data + offset, n);
+        got += n;
+        c->read_seqno += n;
+
+        // the whole packet was read, its space in the buffer is free again
+        if (c->read_seqno == curr->pkt_seqno + curr->data_length) {
+            curr = curr->next;
+            erase_node(w, curr->prev);
+        }
+    }
+
+    if (got > 0) {
+        // the sender stopped at our zero window, it learns right away that there is room again
+        if (c->last_window == 0 && advertised_window(c) > 0) {
+            send_ack(c, ACK, c->recv_base, 0);
+        }
+        return got;
+    }
+    if (c->fin_received) {
+        return 0;
+    }
+    errno = c->state == RDT_FAILED ? ETIMEDOUT : EAGAIN;
+    return -1;
+}
+
+//the descriptor to poll for the connection
+int rdt_fd(rdt_conn * c){
+    return c->transport->fd;
+}
+
+int rdt_listener_fd(rdt_listener * l){
+    return l->transport->fd;
+}
+
+//milliseconds until rdt_tick has something to do even if no packet arrives, -1 if only a packet can change anything
+//a receiver's connections have no timers of their own, rdt_listener_timeout covers them
+int rdt_timeout(rdt_conn * c){
+    uint64_t deadline = 0;
+
+    if (c->state == RDT_SYN_SENT || (c->state == RDT_ESTABLISHED && c->fin_count > 0)) {
+        deadline = c->retry_deadline;
+    }
+    if (c->state == RDT_ESTABLISHED && c->listener == NULL) {
+        if (c->timer != TIMER_OFF && (deadline == 0 || c->timer_deadline < deadline)) {
+            deadline = c->timer_deadline;
+        }
+
+        // a closed receiver window is probed every RTO while nothing is in flight
+        uint64_t probe = c->last_probe + c->rto * 1000ULL;
+        if (c->send_len > 0 && c->send_window->num_of_nodes == 0 && !rwnd_allows(c) && (deadline == 0 || probe < deadline)) {
+            deadline = probe;
+        }
+
+        uint64_t keepalive = c->last_send + KEEPALIVE * 1000ULL;
+        if (c->fin_count == 0 && (deadline == 0 || keepalive < deadline)) {
+            deadline = keepalive;
+        }
+    }
+    if (deadline == 0) {
+        return -1;
+    }
+    uint64_t now = now_usec();
+    return deadline <= now ? 0 : (int) ((deadline - now + 999) / 1000);
+}
+
+//milliseconds until rdt_listener_tick times out the connection that has been quiet the longest, -1 if there is none
+int rdt_listener_timeout(rdt_listener * l){
+    if (l->oldest == NULL) {
+        return -1;
+    }
+    uint64_t deadline = l->oldest->last_recv + RDT_IDLE_TIMEOUT * 1000ULL;
+    uint64_t now = now_usec();
+    return deadline <= now ? 0 : (int) ((deadline - now + 999) / 1000);
+}
+
+//reads what arrived for all of the listener's connections and times out the quiet ones
+//call it when the listener's descriptor is readable or rdt_listener_timeout expired, then take what it found from rdt_accept and rdt_ready
+void rdt_listener_tick(rdt_listener * l){
+    listener_receive(l);
+
+    // a sender that died never tells us, after RDT_IDLE_TIMEOUT without a packet we give up on it
+    uint64_t now = now_usec();
+    while (l->oldest != NULL && now - l->oldest->last_recv >= RDT_IDLE_TIMEOUT * 1000ULL) {
+        VLOG(INFO, "No packet for %d ms, the sender of transfer %016" PRIx64 " is gone", RDT_IDLE_TIMEOUT, l->oldest->transfer_id);
+        end_conn(l->oldest, RDT_FAILED);
+    }
+}
+
+//reads what arrived for the sender's connection and runs its timers, call it when its descriptor is readable or rdt_timeout expired
+//a receiver's connections are served by rdt_listener_tick
+void rdt_tick(rdt_conn * c){
+    if (c->listener != NULL) {
+        return;
+    }
+    conn_receive(c);
+
+    uint64_t now = now_usec();
+    if (c->state == RDT_SYN_SENT && now >= c->retry_deadline) {
+        if (c->syn_count >= SYN_RETRIES) {
+            VLOG(INFO, "No SYN_ACK after %d SYNs", SYN_RETRIES);
+            c->state = RDT_FAILED;
+            return;
+        }
+        VLOG(INFO, "Sending SYN for transfer %016" PRIx64, c->transfer_id);
+        send_control(c, SYN, c->requested);
+        c->syn_count++;
+        c->retry_deadline = now + c->rto * 1000ULL;
+    }
+    if (c->state != RDT_ESTABLISHED) {
+        return;
+    }
+
+    if (c->timer != TIMER_OFF && now >= c->timer_deadline) {
+        int timer = c->timer;
+        c->timer = TIMER_OFF;
+        if (timer == TIMER_TLP) {
+            tail_loss_probe(c);
+        }
+        else {
+            resend_packets(c);
+        }
+    }
+
+    if (c->fin_count > 0 && now >= c->retry_deadline) {
+        if (c->fin_count >= FIN_RETRIES) {
+            VLOG(INFO, "No FIN_ACK after %d FINs, closing anyway", FIN_RETRIES);
+            c->state = RDT_FAILED;
+            return;
+        }
+        VLOG(INFO, "Sending FIN");
+        send_control(c, FIN, c->send_window->next_seqno);
+        c->fin_count++;
+        c->retry_deadline = now + c->rto * 1000ULL;
+    }
+
+    // nothing went out for a while, the receiver answers the probe and knows that we are still there
+    if (c->fin_count == 0 && now >= c->last_send + KEEPALIVE * 1000ULL) {
+        VLOG(INFO, "Sent keepalive probe");
+        send_control(c, PROBE, c->send_window->next_seqno);
+    }
+
+    pump(c);
+}
+
+//frees the connection, a sender's transport is closed with it
+void rdt_close(rdt_conn * c){
+    if (c->listener != NULL) {
+        detach_conn(c->listener, c);
+        if (c->ready) {
+            queue_remove(&c->listener->ready, c);
+        }
+    }
+    else {
+        c->transport->close(c->transport);
+    }
+    free_conn(c);
+}
+
+//turns XOR parity FEC on for a sender, before the first rdt_write
+void rdt_set_fec(rdt_conn * c, int enabled){
+    c->fec_enabled = enabled;
+}
+
+//every change of a sender's congestion window is written to fp as time, window and threshold
+void rdt_set_cwnd_file(rdt_conn * c, FILE * fp){
+    c->cwnd_file = fp;
+}
+
+int rdt_state(rdt_conn * c){
+    return c->state;
+}
+
+//the transfer the sender asked for, 0 when its input cannot be resumed
+uint64_t rdt_transfer_id(rdt_conn * c){
+    return c->transfer_id;
+}
+
+//whether the sender wants to continue where the receiver stopped, instead of starting over
+int rdt_resume_requested(rdt_conn * c){
+    return c->requested != 0;
+}
+
+//the offset the transfer continues from, known on the sender once it is established
+int64_t rdt_start_offset(rdt_conn * c){
+    return c->start_offset;
+}
+
+//CRC32C of the receiver's bytes before the start offset, the sender may check it against its input
+uint32_t rdt_prefix_crc(rdt_conn * c){
+    return c->prefix_crc;
+}
+
+//the sender's congestion window in packets
+int rdt_window(rdt_conn * c){
+    return (int) c->window_size;
+}
+
+//milliseconds since the last valid packet from the peer
+int rdt_idle(rdt_conn * c){
+    return (now_usec() - c->last_recv) / 1000;
+}
+
+void rdt_get_stats(rdt_conn * c, rdt_stats * stats){
+    stats->bytes = c->listener == NULL ? c->send_window->next_seqno - c->start_offset : c->read_seqno - c->start_offset;
+    stats->packets_retransmitted = c->packets_retransmitted;
+    stats->tlp_probes = c->tlp_probes;
+    stats->parity_sent = c->parity_sent;
+    stats->packets_recovered = c->packets_recovered;
+}
+
+//closes the listener's transport, the connections it returned must be closed first
+void rdt_listener_close(rdt_listener * l){
+    rdt_conn * c;
+    while ((c = queue_pop(&l->accepting)) != NULL) {
+        free_conn(c);
+    }
+    l->transport->close(l->transport);
+    free(l);
+}
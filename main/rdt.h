@@ -0,0 +1,66 @@
+#ifndef RDT_H_INCLUDED
+#define RDT_H_INCLUDED
+#include<stdio.h>
+#include<stdint.h>
+#include<stddef.h>
+#include<netinet/in.h>
+
+#include"packet.h"
+#include"transport.h"
+
+#define RDT_SEND_BUFFER (64 * DATA_SIZE) //the bytes a sender accepts from rdt_write before they fit into its window
+#define RDT_RECV_BUFFER 256 //the packets a receiver buffers, in order ones that were not read yet and out of order ones
+#define RDT_IDLE_TIMEOUT 30000 //milliseconds without a packet from its sender after which a receiver's connection fails
+
+//the states of a connection
+enum rdt_state {
+    RDT_SYN_SENT, //the sender waits for the SYN_ACK
+    RDT_SYN_RECEIVED, //the receiver got a SYN, it answers once rdt_start tells it where the transfer starts
+    RDT_ESTABLISHED,
+    RDT_CLOSED, //the sender's FIN was ACKed
+    RDT_FAILED, //the peer never answered our SYN, our FIN or a resent packet, or a receiver heard nothing for RDT_IDLE_TIMEOUT
+    RDT_RESET, //the sender of this connection opened a new one
+};
+
+//the receiver's end of a transport, one thread serves all of the connections it accepts through rdt_accept and rdt_ready
+typedef struct rdt_listener rdt_listener;
+
+//one end of a transfer, only the functions below touch it so that one thread can drive many of them
+typedef struct rdt_conn rdt_conn;
+
+//what a connection did so far
+typedef struct {
+    int64_t bytes; //the bytes of the stream sent, or read on the receiver, after the start offset
+    int packets_retransmitted;
+    int tlp_probes;
+    int parity_sent;
+    int packets_recovered; //rebuilt from parity on the receiver
+} rdt_stats;
+
+rdt_conn * rdt_connect(transport * t, uint64_t transfer_id, int resume);
+rdt_listener * rdt_listen(transport * t);
+rdt_conn * rdt_accept(rdt_listener * l);
+rdt_conn * rdt_ready(rdt_listener * l);
+void rdt_start(rdt_conn * c, int64_t offset, uint32_t prefix_crc);
+long rdt_write(rdt_conn * c, const char * data, size_t len);
+void rdt_shutdown(rdt_conn * c);
+long rdt_read(rdt_conn * c, char * dst, size_t len);
+int rdt_fd(rdt_conn * c);
+int rdt_listener_fd(rdt_listener * l);
+int rdt_timeout(rdt_conn * c);
+int rdt_listener_timeout(rdt_listener * l);
+void rdt_tick(rdt_conn * c);
+void rdt_listener_tick(rdt_listener * l);
+void rdt_close(rdt_conn * c);
+void rdt_set_fec(rdt_conn * c, int enabled);
+void rdt_set_cwnd_file(rdt_conn * c, FILE * fp);
+int rdt_state(rdt_conn * c);
+uint64_t rdt_transfer_id(rdt_conn * c);
+int rdt_resume_requested(rdt_conn * c);
+int64_t rdt_start_offset(rdt_conn * c);
+uint32_t rdt_prefix_crc(rdt_conn * c);
+int rdt_window(rdt_conn * c);
+int rdt_idle(rdt_conn * c);
+void rdt_get_stats(rdt_conn * c, rdt_stats * stats);
+void rdt_listener_close(rdt_listener * l);
+#endif
@@ -2,180 +2,340 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/types.h> 
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <sys/time.h>
-#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include "common.h"
-#include "create_window.h"
+#include "rdt.h"
+#include "compress.h"
+#include "checksum.h"
+#include "checkpoint.h"
+#include "session.h"
 
-tcp_packet *recvpkt;
-tcp_packet *sndpkt;
+// every byte of the stream before this offset has been written to the output
+int64_t stream_offset = 0;
 
-// our receive base starts at seqno 0
-int recv_base = 0;
+// with -z the stream is made of compressed blocks, which we decompress on worker threads before writing them
+compressor *decompressor = NULL;
 
-// looks for sequential packets in the window and writes them to the file
-void write_to_file(FILE* fp, int seqno, window* recv_window) {
-    node* curr = recv_window->head->next;
+// with -s the stream is a session of framed files, which we write below the output directory
+session *output_session = NULL;
 
-    // checks if the seqno of the current packet matches the receive base, if it does it means that the packet is in order
-    while (curr != recv_window->tail && curr->pkt_seqno == recv_base) {
-        fwrite(curr->data, 1, curr->data_length, fp);
+// the in order bytes go to output, which is the file, the session or the decompressor in front of either
+write_fn output;
+void *sink;
 
-        // updates the receive base such that it is the seqno of the next packet, so that we can check if the next packet is in order
-        recv_base += curr->data_length;
-        curr = curr->next;
+// the transfer we are receiving, 0 until a sender opened one or when it cannot be resumed
+uint64_t transfer_id = 0;
 
-        // removes the packet which have already been written to the file
-        erase_node(recv_window, curr->prev);
+// CRC32C of every byte before stream_offset, a resuming sender can check it against its input
+uint32_t prefix_crc = 0;
+
+// the checkpoint next to the output file, NULL when the output cannot be resumed
+// a thread of its own saves it, so the fsyncs never hold up the packets and their ACKs
+char *checkpoint_path = NULL;
+checkpointer *saver = NULL;
+checkpoint progress;
+uint64_t last_checkpoint = 0;
+
+// the checkpoint was fsynced after the bytes it covers, so we trust it, with -v we first hash the output's prefix to check it
+int verify_checkpoint = 0;
+
+// we read the stream from the connection in chunks of this many bytes
+#define READ_CHUNK (16 * DATA_SIZE)
+
+// after the FIN we keep answering repeated FINs for this many milliseconds in case our FIN_ACK got lost
+#define FIN_LINGER 2000
+
+// a write_fn for a plain output file
+void write_file(void* sink, const char* data, size_t len) {
+    fwrite(data, 1, len, (FILE*) sink);
+}
+
+// writes the in order bytes we read from the connection to the output
+void write_to_file(FILE* fp, const char* data, size_t len) {
+    output(sink, data, len);
+    prefix_crc = crc32c(prefix_crc, data, len);
+    stream_offset += len;
+
+    // every few megabytes or every second we make what we wrote durable, a new receiver resumes from there
+    if (checkpoint_path != NULL && transfer_id != 0 && stream_offset > progress.offset) {
+        uint64_t now = now_usec();
+        if (stream_offset - progress.offset >= CHECKPOINT_BYTES || now - last_checkpoint >= CHECKPOINT_MS * 1000ULL) {
+            progress.transfer_id = transfer_id;
+            progress.offset = stream_offset;
+            progress.prefix_crc = prefix_crc;
+            if (fflush(fp) != 0) {
+                error("fflush");
+            }
+            checkpoint_async(saver, &progress);
+            last_checkpoint = now;
+            VLOG(INFO, "Checkpoint at offset %" PRId64, stream_offset);
+        }
     }
 }
 
+// throws away everything we received so far, the transfer starts over at offset 0
+void restart_transfer(FILE* fp) {
+    if (stream_offset > 0) {
+        // stdout and the decompressor cannot take back what they already got
+        if (checkpoint_path == NULL) {
+            fprintf(stderr, "ERROR, the sender starts over but %" PRId64 " bytes were already written\n", stream_offset);
+            exit(1);
+        }
+        // a checkpoint still being saved must not land after we removed it
+        checkpoint_wait(saver);
+        fflush(fp);
+        if (ftruncate(fileno(fp), 0) < 0) {
+            error("ftruncate");
+        }
+        fseek(fp, 0, SEEK_SET);
+        remove_checkpoint(checkpoint_path);
+        progress.offset = 0;
+    }
+
+    stream_offset = 0;
+    prefix_crc = 0;
+}
+
+// opens the output, and picks up the transfer its checkpoint describes if there is one
+FILE* open_output(char* output_name, int decompress) {
+    int fd = open(output_name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        error(output_name);
+    }
+    FILE* fp = fdopen(fd, "r+b");
+
+    // the decompressed file has other offsets than the stream, so only a plain transfer can be resumed
+    if (!decompress) {
+        checkpoint_path = malloc(strlen(output_name) + 6);
+        sprintf(checkpoint_path, "%s.ckpt", output_name);
+    }
+
+    // a checkpoint past the end of the file belongs to some other file
+    // reading back a prefix of hundreds of gigabytes takes long, so only -v checks that it is what the checkpoint says
+    struct stat st;
+    if (checkpoint_path != NULL && load_checkpoint(checkpoint_path, &progress) && fstat(fd, &st) == 0 && st.st_size >= progress.offset &&
+            (!verify_checkpoint || hash_prefix(fd, progress.offset) == progress.prefix_crc)) {
+        transfer_id = progress.transfer_id;
+        stream_offset = progress.offset;
+        prefix_crc = progress.prefix_crc;
+        VLOG(INFO, "Checkpoint of transfer %016" PRIx64 " at offset %" PRId64, transfer_id, stream_offset);
+    }
+    else {
+        progress.offset = 0;
+    }
+
+    // whatever was written after the checkpoint may not have reached the disk, it is received again
+    if (ftruncate(fd, stream_offset) < 0) {
+        error("ftruncate");
+    }
+    fseek(fp, stream_offset, SEEK_SET);
+    last_checkpoint = now_usec();
+    if (checkpoint_path != NULL) {
+        saver = create_checkpointer(checkpoint_path, fd);
+    }
+    return fp;
+}
+
+// the stream is complete, everything still on its way to the output is written and the output is closed
+// returns the exit status, which is not 0 when the output is not complete
+int finish_output(FILE* fp, uint64_t start_time) {
+    int status = 0;
+
+    // the blocks still being decompressed are written before we close the file
+    if (decompressor != NULL) {
+        compress_flush(decompressor);
+        compress_report(decompressor, (now_usec() - start_time) / 1000000.0);
+        free_compressor(decompressor);
+        decompressor = NULL;
+    }
+
+    // the last file of a session must be complete
+    if (output_session != NULL) {
+        if (!session_finish(output_session)) {
+            fprintf(stderr, "ERROR, the session ended in the middle of a file\n");
+            status = 1;
+        }
+        VLOG(INFO, "Received %d files, %llu bytes of data", output_session->files, (unsigned long long) output_session->bytes);
+    }
+
+    // the whole file is on disk, there is nothing left to resume
+    if (checkpoint_path != NULL) {
+        free_checkpointer(saver);
+        saver = NULL;
+        fflush(fp);
+        fsync(fileno(fp));
+        remove_checkpoint(checkpoint_path);
+    }
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    return status;
+}
+
 int main(int argc, char **argv) {
-    int sockfd; /* socket */
     int portno; /* port to listen on */
-    int clientlen; /* byte size of client's address */
-    struct sockaddr_in serveraddr; /* server's addr */
-    struct sockaddr_in clientaddr; /* client addr */
-    int optval; /* flag value for setsockopt */
     FILE *fp;
-    char buffer[MSS_SIZE];
-    struct timeval tp;
+    char buffer[READ_CHUNK];
+    int finished = 0; /* set once the FIN has been ACKed */
+    int status = 0; /* what we exit with, not 0 when the output is incomplete */
+    int decompress = 0; /* set with -z when the sender compresses */
+    int session_mode = 0; /* set with -s when the sender sends a session of files */
+    int shared_memory = 0; /* set with -m when the senders run on this host */
+    uint64_t start_time = 0; /* when the transfer started */
+
+    // the programs log every packet, the library alone stays quiet
+    rdt_verbose = ALL;
 
-    /* 
-     * check command line arguments 
+    /*
+     * check command line arguments
      */
-    if (argc != 3) {
-        fprintf(stderr, "usage: %s <port> FILE_RECVD\n", argv[0]);
+    int opt;
+    while ((opt = getopt(argc, argv, "msvz")) != -1) {
+        switch (opt) {
+            case 'm':
+                shared_memory = 1;
+                break;
+            case 's':
+                session_mode = 1;
+                break;
+            case 'v':
+                verify_checkpoint = 1;
+                break;
+            case 'z':
+                decompress = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-m] [-v] [-z] <port> FILE_RECVD|-\n       %s -s [-m] [-z] <port> DIR\n", argv[0], argv[0]);
+                exit(1);
+        }
+    }
+    if (argc - optind != 2) {
+        fprintf(stderr, "usage: %s [-m] [-v] [-z] <port> FILE_RECVD|-\n       %s -s [-m] [-z] <port> DIR\n", argv[0], argv[0]);
         exit(1);
     }
-    portno = atoi(argv[1]);
+    portno = atoi(argv[optind]);
+    char *output_name = argv[optind + 1];
 
-    fp  = fopen(argv[2], "wb");
-    if (fp == NULL) {
-        error(argv[2]);
+    // a session writes every file it carries below the output directory
+    if (session_mode) {
+        fp = NULL;
+        output_session = create_session_writer(output_name);
+        output = session_write;
+        sink = output_session;
+    }
+    // "-" writes the stream to stdout, so the receiver can feed a pipe
+    else if (strcmp(output_name, "-") == 0) {
+        fp = stdout;
+        output = write_file;
+        sink = fp;
+    }
+    else {
+        fp = open_output(output_name, decompress);
+        output = write_file;
+        sink = fp;
     }
 
-    /* 
-     * socket: create the parent socket 
-     */
-    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sockfd < 0) 
-        error("ERROR opening socket");
-
-    /* setsockopt: Handy debugging trick that lets 
-     * us rerun the server immediately after we kill it; 
-     * otherwise we have to wait about 20 secs. 
-     * Eliminates "ERROR on binding: Address already in use" error. 
-     */
-    optval = 1;
-    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, 
-            (const void *)&optval , sizeof(int));
+    if (decompress) {
+        decompressor = create_decompressor(output, sink);
+        output = decompress_write;
+        sink = decompressor;
+    }
 
     /*
-     * build the server's Internet address
-     */
-    bzero((char *) &serveraddr, sizeof(serveraddr));
-    serveraddr.sin_family = AF_INET;
-    serveraddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    serveraddr.sin_port = htons((unsigned short)portno);
-
-    /* 
-     * bind: associate the parent socket with a port 
+     * listen: bind the socket, or with -m the shared memory transport, that the connections of our senders share
      */
-    if (bind(sockfd, (struct sockaddr *) &serveraddr, 
-                sizeof(serveraddr)) < 0) 
+    transport *t = shared_memory ? shm_listen(portno) : udp_listen(portno);
+    if (t == NULL)
         error("ERROR on binding");
+    rdt_listener *listener = rdt_listen(t);
 
-    /* 
-     * main loop: wait for a datagram, then echo it
-     */
     VLOG(DEBUG, "epoch time, bytes received, sequence number");
 
-    // creating the receive window
-    window *recv_window = create_window();
-
-    clientlen = sizeof(clientaddr);
+    rdt_conn *conn = NULL;
     while (1) {
-        /*
-         * recvfrom: receive a UDP datagram from a client
-         */
-        //VLOG(DEBUG, "waiting from server \n");
-        if (recvfrom(sockfd, buffer, MSS_SIZE, 0,
-                (struct sockaddr *) &clientaddr, (socklen_t *)&clientlen) < 0) {
-            error("ERROR in recvfrom");
-        }
-        recvpkt = (tcp_packet *) buffer;
-        assert(get_data_size(recvpkt) <= DATA_SIZE);
-
-        // if the packet is empty, it means that the file has been completely received
-        if ( recvpkt->hdr.data_size == 0) {
-            VLOG(INFO, "End Of File has been reached");
-            // sndpkt = make_packet(0);
-            // sndpkt->hdr.ackno = -1;
-
-            // sndpkt->hdr.seqno = recvpkt->hdr.seqno;
-            // sndpkt->hdr.ctr_flags = ACK;
-            // if (sendto(sockfd, sndpkt, TCP_HDR_SIZE, 0, 
-            //         (struct sockaddr *) &clientaddr, clientlen) < 0) {
-            //     error("ERROR in sendto");
-            // }
-            fclose(fp);
-            break;
-        }
-        /* 
-         * sendto: ACK back to the client 
-         */
-        gettimeofday(&tp, NULL);
-        VLOG(DEBUG, "%lu, %d, %d", tp.tv_sec, recvpkt->hdr.data_size, recvpkt->hdr.seqno);
-        
-        // if the packet is out of order, we send an ack with the current receive base
-        // in this case, the packet received is less than the receive base which means that it is a duplicate packet
-        if (recvpkt->hdr.seqno < recv_base) {
-            sndpkt = make_packet(0);
-            sndpkt->hdr.ackno = recv_base;
-            
-            // we record the sequence number of the packet that we received, so that the client knows which packet is ACKing
-            sndpkt->hdr.seqno = recvpkt->hdr.seqno;
-            sndpkt->hdr.ctr_flags = ACK;
-            if (sendto(sockfd, sndpkt, TCP_HDR_SIZE, 0, 
-                    (struct sockaddr *) &clientaddr, clientlen) < 0) {
-                error("ERROR in sendto");
+        // after the FIN we only wait for repeated FINs, the sender got our FIN_ACK once it stops repeating it
+        int timeout = rdt_listener_timeout(listener);
+        if (finished) {
+            int quiet = rdt_idle(conn);
+            if (quiet >= FIN_LINGER) {
+                break;
             }
+            timeout = FIN_LINGER - quiet;
         }
-        else{
-            // checking if the packet being sent can be fitted into the receive window
-            if (recvpkt->hdr.seqno >= recv_base) {
-
-                // we buffer all the packets in the window
-                recv_add_node(recv_window, recvpkt->data, recvpkt->hdr.data_size, recvpkt->hdr.seqno);
-
-                // we write to the file all the packets that are in order
-                write_to_file(fp, recvpkt->hdr.seqno, recv_window);
-
-                // sending cumulative acks
-                sndpkt = make_packet(0);
-                sndpkt->hdr.ackno = recv_base;
-
-                // we record the sequence number of the packet that we received, so that the client knows which packet is ACKing
-                sndpkt->hdr.seqno = recvpkt->hdr.seqno;
-                sndpkt->hdr.ctr_flags = ACK;
-                if (sendto(sockfd, sndpkt, TCP_HDR_SIZE, 0, 
-                        (struct sockaddr *) &clientaddr, clientlen) < 0) {
-                    error("ERROR in sendto");
-                }
+
+        struct pollfd pfd = {.fd = rdt_listener_fd(listener), .events = POLLIN};
+        poll(&pfd, 1, timeout);
+        rdt_listener_tick(listener);
+
+        // a new connection resumes the transfer if it is the one we have, otherwise it starts over
+        rdt_conn *c;
+        while ((c = rdt_accept(listener)) != NULL) {
+            if (finished) {
+                rdt_close(c);
+                continue;
+            }
+            if (rdt_transfer_id(c) == 0 || rdt_transfer_id(c) != transfer_id || !rdt_resume_requested(c)) {
+                restart_transfer(fp);
+            }
+            transfer_id = rdt_transfer_id(c);
+
+            // the old connection's sender is gone, what it sent past stream_offset is sent again
+            if (conn != NULL) {
+                rdt_close(conn);
+            }
+            conn = c;
+            rdt_start(conn, stream_offset, prefix_crc);
+            if (start_time == 0) {
+                start_time = now_usec();
             }
         }
 
-        VLOG(INFO, "Window Size: %d, Recv Base: %d", recv_window->num_of_nodes, recv_base);
+        // the connections we closed left the ready queue with them, so only ours can be in it
+        while ((c = rdt_ready(listener)) != NULL) {
+            if (c != conn || finished) {
+                continue;
+            }
+
+            long len;
+            while ((len = rdt_read(conn, buffer, READ_CHUNK)) > 0) {
+                write_to_file(fp, buffer, len);
+            }
+
+            // whoever reads the stream should see the data as soon as it is in order
+            if (fp == stdout) {
+                fflush(fp);
+            }
+
+            // the FIN marks the end of the file, the connection only reports it once everything before it was read
+            if (len == 0) {
+                VLOG(INFO, "End Of File has been reached");
+                status = finish_output(fp, start_time);
+                finished = 1;
+            }
+            // the sender died without a FIN, we keep what we have and wait for it to resume
+            else if (errno == ETIMEDOUT) {
+                VLOG(INFO, "The sender is gone, waiting for it to resume at offset %" PRId64, stream_offset);
+                rdt_close(conn);
+                conn = NULL;
+            }
+        }
     }
 
-    close(sockfd);
-    free_window(recv_window);
+    rdt_stats stats;
+    rdt_get_stats(conn, &stats);
+    VLOG(INFO, "Recovered %d packets from parity", stats.packets_recovered);
+
+    rdt_close(conn);
+    rdt_listener_close(listener);
+    free(checkpoint_path);
+    if (output_session != NULL) {
+        free_session(output_session);
+    }
 
-    return 0;
+    return status;
 }
@@ -0,0 +1,199 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<errno.h>
+#include<poll.h>
+#include<sys/eventfd.h>
+
+#include"common.h"
+#include"packet.h"
+#include"read_ahead.h"
+
+//reads up to len bytes from the fd source points at, a stream that pauses mid packet gets READ_AHEAD_FLUSH_MS to complete it
+long read_fd(void * source, char * dst, size_t len){
+    int fd = *(int *) source;
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    size_t got = 0;
+
+    while (got < len){
+        ssize_t n = read(fd, dst + got, len - got);
+        if (n < 0){
+            if (errno == EINTR) {continue;}
+            error("read");
+        }
+        if (n == 0){
+            return got > 0 ? (long) got : -1;
+        }
+        got += n;
+
+        // whole packets are handed over as soon as nothing more is waiting, a partial one only after the flush delay
+        if (got < len && poll(&pfd, 1, got % DATA_SIZE ? READ_AHEAD_FLUSH_MS : 0) == 0){
+            break;
+        }
+    }
+
+    return got;
+}
+
+//wakes up whoever waits on the eventfd
+static void signal_event(int fd){
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) < 0 && errno == EINTR);
+}
+
+//clears an eventfd, on the producer's blocking one this waits for the sender's signal
+static void drain_event(int fd){
+    uint64_t count;
+    while (read(fd, &count, sizeof(count)) < 0 && errno == EINTR);
+}
+
+//publishes what the producer put into the ring, and wakes the sender if it sleeps on an empty ring
+static void publish(read_ahead * ra){
+    // the sender sets its flag before it checks the ring a last time, so either it sees our buffers or we see its flag
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ra->consumer_waiting, memory_order_relaxed) && atomic_exchange(&ra->consumer_waiting, 0)) {
+        signal_event(ra->ready_fd);
+    }
+}
+
+//the producer thread, it reads the input in large chunks and splits them into packet sized buffers
+void* read_ahead_thread(void * arg){
+    read_ahead * ra = arg;
+    long tail = atomic_load_explicit(&ra->tail, memory_order_relaxed);
+
+    while (!atomic_load(&ra->closed)){
+        long ready = tail - atomic_load_explicit(&ra->head, memory_order_acquire);
+        int depth = atomic_load_explicit(&ra->depth, memory_order_relaxed);
+
+        // we already have enough buffers waiting for the sender, so we sleep until it took about a chunk of them
+        if (ready >= depth){
+            long wake = depth > 2 * READ_AHEAD_CHUNK ? depth - READ_AHEAD_CHUNK : depth / 2;
+            atomic_store(&ra->producer_wake, wake);
+            if (tail - atomic_load(&ra->head) >= wake && !atomic_load(&ra->closed)){
+                drain_event(ra->space_fd);
+            }
+            atomic_store(&ra->producer_wake, 0);
+            continue;
+        }
+
+        // we only read into contiguous buffers, so a chunk stops at the end of the ring
+        int slot = tail % READ_AHEAD_SLOTS;
+        int count = depth - ready;
+        if (count > READ_AHEAD_CHUNK) {count = READ_AHEAD_CHUNK;}
+        if (count > READ_AHEAD_SLOTS - slot) {count = READ_AHEAD_SLOTS - slot;}
+
+        long len = ra->read(ra->source, ra->slots + (size_t) slot * DATA_SIZE, (size_t) count * DATA_SIZE);
+        if (len < 0){
+            atomic_store_explicit(&ra->eof, 1, memory_order_release);
+            publish(ra);
+            break;
+        }
+
+        // every buffer is full apart from the last one of what we read
+        int filled = 0;
+        while (len > 0){
+            ra->lengths[slot + filled] = len > DATA_SIZE ? DATA_SIZE : len;
+            len -= ra->lengths[slot + filled];
+            filled++;
+        }
+
+        // publishing the buffers only after their lengths are written
+        tail += filled;
+        atomic_store_explicit(&ra->tail, tail, memory_order_release);
+        publish(ra);
+    }
+
+    return NULL;
+}
+
+//creates the ring and starts reading the input ahead of the sender
+read_ahead * create_read_ahead(read_fn read, void * source){
+    read_ahead * ra = malloc(sizeof(read_ahead));
+
+    ra->read = read;
+    ra->source = source;
+    ra->slots = malloc((size_t) READ_AHEAD_SLOTS * DATA_SIZE);
+    atomic_init(&ra->head, 0);
+    atomic_init(&ra->tail, 0);
+    atomic_init(&ra->depth, READ_AHEAD_CHUNK);
+    atomic_init(&ra->eof, 0);
+    atomic_init(&ra->closed, 0);
+    atomic_init(&ra->producer_wake, 0);
+    atomic_init(&ra->consumer_waiting, 0);
+    ra->space_fd = eventfd(0, EFD_CLOEXEC);
+    ra->ready_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ra->space_fd < 0 || ra->ready_fd < 0){
+        error("eventfd");
+    }
+
+    int rc = pthread_create(&ra->thread, NULL, read_ahead_thread, ra);
+    if (rc){
+        printf("ERROR: Unable to create thread %d\n", rc);
+        exit(-1);
+    }
+
+    return ra;
+}
+
+//sets how many buffers the producer keeps ready, the sender ties this to its window size
+void read_ahead_set_depth(read_ahead * ra, int depth){
+    if (depth < READ_AHEAD_CHUNK) {depth = READ_AHEAD_CHUNK;}
+    if (depth > READ_AHEAD_SLOTS) {depth = READ_AHEAD_SLOTS;}
+    int old = atomic_exchange(&ra->depth, depth);
+
+    // a deeper ring has room for the producer right away
+    if (depth > old && atomic_load(&ra->producer_wake) && atomic_exchange(&ra->producer_wake, 0)){
+        signal_event(ra->space_fd);
+    }
+}
+
+//copies the next packet into the buffer and returns its length, 0 if none is ready yet and -1 once the whole input has been popped
+int read_ahead_try_pop(read_ahead * ra, char * buffer){
+    long head = atomic_load_explicit(&ra->head, memory_order_relaxed);
+    long tail = atomic_load_explicit(&ra->tail, memory_order_acquire);
+
+    // the ring is empty, we ask the producer to signal ready_fd and look a last time in case it published in the meantime
+    if (head == tail && !atomic_load_explicit(&ra->consumer_waiting, memory_order_relaxed)){
+        drain_event(ra->ready_fd);
+        atomic_store(&ra->consumer_waiting, 1);
+        tail = atomic_load(&ra->tail);
+    }
+
+    if (head < tail){
+        int slot = head % READ_AHEAD_SLOTS;
+        int len = ra->lengths[slot];
+        memcpy(buffer, ra->slots + (size_t) slot * DATA_SIZE, len);
+
+        // handing the buffer back to the producer, it sleeps until the ring drained below its mark
+        atomic_store_explicit(&ra->head, head + 1, memory_order_release);
+        atomic_thread_fence(memory_order_seq_cst);
+        long wake = atomic_load_explicit(&ra->producer_wake, memory_order_relaxed);
+        if (wake && tail - (head + 1) < wake && atomic_exchange(&ra->producer_wake, 0)){
+            signal_event(ra->space_fd);
+        }
+        return len;
+    }
+
+    // the producer sets eof after its last tail update, so a ring that is still empty after it is the end of the input
+    if (atomic_load_explicit(&ra->eof, memory_order_acquire) && head == atomic_load_explicit(&ra->tail, memory_order_acquire)){
+        return -1;
+    }
+    return 0;
+}
+
+//readable once read_ahead_try_pop has something new after it returned 0, poll it next to the connection
+int read_ahead_fd(read_ahead * ra){
+    return ra->ready_fd;
+}
+
+//stops the producer, waits for it to finish and frees the ring
+void free_read_ahead(read_ahead * ra){
+    atomic_store(&ra->closed, 1);
+    signal_event(ra->space_fd);
+    pthread_join(ra->thread, NULL);
+    close(ra->space_fd);
+    close(ra->ready_fd);
+    free(ra->slots);
+    free(ra);
+}
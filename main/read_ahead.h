@@ -0,0 +1,38 @@
+#ifndef READ_AHEAD_H_INCLUDED
+#define READ_AHEAD_H_INCLUDED
+#include<stddef.h>
+#include<pthread.h>
+#include<stdatomic.h>
+
+#define READ_AHEAD_SLOTS 1024 //the number of packets the ring can hold
+#define READ_AHEAD_CHUNK 64 //the most packets we read from the file in one go
+#define READ_AHEAD_FLUSH_MS 5 //how long a paused stream may keep a packet partly filled before we send it anyway
+
+//reads up to len bytes from source, returns -1 at the end of the input
+typedef long (*read_fn)(void * source, char * dst, size_t len);
+
+//single producer single consumer ring of packet sized buffers, filled ahead of the sender by a separate thread
+typedef struct {
+    read_fn read; //reads the input, only the producer thread calls it
+    void * source; //the file descriptor or the compressor we are reading from
+    char * slots; //READ_AHEAD_SLOTS buffers of DATA_SIZE bytes each
+    int lengths[READ_AHEAD_SLOTS]; //the number of bytes in each buffer
+    atomic_long head; //the next buffer the sender pops, only the sender moves it
+    atomic_long tail; //the next buffer the producer fills, only the producer moves it
+    atomic_int depth; //the number of buffers the producer tries to keep ready
+    atomic_int eof; //set by the producer once the whole file is in the ring
+    atomic_int closed; //set when the sender frees the ring before the end of the input
+    atomic_long producer_wake; //while the producer sleeps, the number of ready buffers below which the sender wakes it up, 0 otherwise
+    atomic_int consumer_waiting; //set by a sender that found the ring empty, the producer then signals ready_fd
+    int space_fd; //the eventfd the producer sleeps on
+    int ready_fd; //the eventfd the sender polls, readable once a buffer or the end of the input is published
+    pthread_t thread;
+} read_ahead;
+
+long read_fd(void * source, char * dst, size_t len);
+read_ahead * create_read_ahead(read_fn read, void * source);
+void read_ahead_set_depth(read_ahead * ra, int depth);
+int read_ahead_try_pop(read_ahead * ra, char * buffer);
+int read_ahead_fd(read_ahead * ra);
+void free_read_ahead(read_ahead * ra);
+#endif
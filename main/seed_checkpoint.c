@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "checkpoint.h"
+
+// writes the checkpoint a receiver would have saved after the first OFFSET bytes of INPUT went to OUTPUT
+// the tests use it to resume a transfer at any offset without sending everything before it
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s INPUT OUTPUT OFFSET\n", argv[0]);
+        exit(1);
+    }
+    char *input_name = argv[1];
+    char *output_name = argv[2];
+    int64_t offset = strtoll(argv[3], NULL, 0);
+
+    int input_fd = open(input_name, O_RDONLY);
+    if (input_fd < 0) {
+        error(input_name);
+    }
+    FILE *fp = fopen(output_name, "r+b");
+    if (fp == NULL) {
+        error(output_name);
+    }
+
+    // the receiver only resumes from a checkpoint whose prefix is what is on disk
+    checkpoint ckpt;
+    ckpt.transfer_id = file_transfer_id(input_fd, input_name);
+    ckpt.offset = offset;
+    ckpt.prefix_crc = hash_prefix(fileno(fp), offset);
+    if (ckpt.transfer_id == 0 || ckpt.prefix_crc != hash_prefix(input_fd, offset)) {
+        fprintf(stderr, "ERROR, the first %" PRId64 " bytes of %s are not those of %s\n", offset, output_name, input_name);
+        exit(1);
+    }
+
+    char path[strlen(output_name) + 6];
+    sprintf(path, "%s.ckpt", output_name);
+    save_checkpoint(path, fileno(fp), &ckpt);
+
+    fclose(fp);
+    close(input_fd);
+    return 0;
+}
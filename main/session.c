@@ -0,0 +1,288 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<dirent.h>
+#include<libgen.h>
+#include<endian.h>
+#include<arpa/inet.h>
+#include<sys/stat.h>
+
+#include"common.h"
+#include"session.h"
+
+//adds one file to the sender's list, name is the path the receiver writes it to
+static void add_file(session * s, const char * path, const char * name){
+    s->paths = realloc(s->paths, (s->count + 1) * sizeof(char *));
+    s->names = realloc(s->names, (s->count + 1) * sizeof(char *));
+    s->paths[s->count] = strdup(path);
+    s->names[s->count] = strdup(name);
+    s->count++;
+}
+
+//adds every regular file below a directory, symbolic links and special files are skipped
+static void add_directory(session * s, const char * path, const char * name){
+    DIR * dir = opendir(path);
+    if (dir == NULL){
+        error((char *) path);
+    }
+
+    struct dirent * entry;
+    while ((entry = readdir(dir)) != NULL){
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0){
+            continue;
+        }
+
+        char child_path[strlen(path) + strlen(entry->d_name) + 2];
+        char child_name[strlen(name) + strlen(entry->d_name) + 2];
+        sprintf(child_path, "%s/%s", path, entry->d_name);
+        sprintf(child_name, "%s/%s", name, entry->d_name);
+
+        struct stat st;
+        if (lstat(child_path, &st) < 0){
+            error(child_path);
+        }
+        if (S_ISDIR(st.st_mode)){
+            add_directory(s, child_path, child_name);
+        }
+        else if (S_ISREG(st.st_mode)){
+            add_file(s, child_path, child_name);
+        }
+    }
+    closedir(dir);
+}
+
+//the sender's session, every input is a file or a directory that is sent under its own name
+session * create_session(char ** inputs, int count){
+    session * s = calloc(1, sizeof(session));
+    s->fd = -1;
+
+    for (int i = 0; i < count; i++){
+        struct stat st;
+        if (stat(inputs[i], &st) < 0){
+            error(inputs[i]);
+        }
+
+        char * copy = strdup(inputs[i]);
+        char * name = basename(copy);
+        if (S_ISDIR(st.st_mode)){
+            add_directory(s, inputs[i], name);
+        }
+        else{
+            add_file(s, inputs[i], name);
+        }
+        free(copy);
+    }
+
+    return s;
+}
+
+//opens the next file of the list and builds its frame header
+static void open_next(session * s){
+    const char * name = s->names[s->next];
+    size_t name_len = strlen(name);
+    if (name_len > SESSION_PATH_MAX){
+        fprintf(stderr, "ERROR, the path %s is too long\n", name);
+        exit(1);
+    }
+
+    s->fd = open(s->paths[s->next], O_RDONLY);
+    struct stat st;
+    if (s->fd < 0 || fstat(s->fd, &st) < 0){
+        error(s->paths[s->next]);
+    }
+    s->next++;
+    s->left = st.st_size;
+
+    uint16_t path_len = htons(name_len);
+    uint64_t size = htobe64(st.st_size);
+    memcpy(s->header, &path_len, 2);
+    memcpy(s->header + 2, &size, 8);
+    memcpy(s->header + SESSION_FRAME_HDR, name, name_len);
+    s->header_len = 0;
+    s->header_size = SESSION_FRAME_HDR + name_len;
+
+    VLOG(INFO, "Sending %s (%lld bytes)", name, (long long) st.st_size);
+}
+
+//a read_fn for the read ahead thread, the files follow each other without a gap so small files share packets
+long session_read(void * source, char * dst, size_t len){
+    session * s = source;
+    size_t got = 0;
+
+    while (got < len){
+        // the frame header goes out before the file
+        if (s->header_len < s->header_size){
+            size_t n = s->header_size - s->header_len;
+            if (n > len - got) {n = len - got;}
+            memcpy(dst + got, s->header + s->header_len, n);
+            s->header_len += n;
+            got += n;
+            continue;
+        }
+
+        if (s->fd >= 0 && s->left > 0){
+            size_t want = len - got;
+            if ((int64_t) want > s->left) {want = s->left;}
+            ssize_t n = read(s->fd, dst + got, want);
+            if (n < 0){
+                if (errno == EINTR) {continue;}
+                error("read");
+            }
+            // the header already promised the receiver the whole file
+            if (n == 0){
+                fprintf(stderr, "ERROR, %s got shorter while we sent it\n", s->names[s->next - 1]);
+                exit(1);
+            }
+            got += n;
+            s->left -= n;
+            s->bytes += n;
+            continue;
+        }
+
+        if (s->fd >= 0){
+            close(s->fd);
+            s->fd = -1;
+            s->files++;
+        }
+        if (s->next == s->count){
+            break;
+        }
+        open_next(s);
+    }
+
+    return got > 0 ? (long) got : -1;
+}
+
+//the receiver's session, the files are written below dir
+session * create_session_writer(const char * dir){
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST){
+        error((char *) dir);
+    }
+
+    session * s = calloc(1, sizeof(session));
+    s->receiver = 1;
+    s->dir = strdup(dir);
+    s->fd = -1;
+    return s;
+}
+
+//creates the file the header names, a path may not leave the output directory
+static void create_file(session * s){
+    char * name = s->header + SESSION_FRAME_HDR;
+    name[s->header_size - SESSION_FRAME_HDR] = '\0';
+
+    if (name[0] == '/' || strcmp(name, "..") == 0 || strncmp(name, "../", 3) == 0 ||
+            strstr(name, "/../") != NULL || (strlen(name) >= 3 && strcmp(name + strlen(name) - 3, "/..") == 0)){
+        fprintf(stderr, "ERROR, refusing to write %s outside of %s\n", name, s->dir);
+        exit(1);
+    }
+
+    char path[strlen(s->dir) + strlen(name) + 2];
+    sprintf(path, "%s/%s", s->dir, name);
+
+    // the directories on the way are created as we need them
+    for (char * slash = strchr(path + strlen(s->dir) + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/')){
+        *slash = '\0';
+        if (mkdir(path, 0755) < 0 && errno != EEXIST){
+            error(path);
+        }
+        *slash = '/';
+    }
+
+    s->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (s->fd < 0){
+        error(path);
+    }
+    VLOG(INFO, "Receiving %s (%lld bytes)", name, (long long) s->left);
+}
+
+//the file we write is complete
+static void close_file(session * s){
+    close(s->fd);
+    s->fd = -1;
+    s->files++;
+}
+
+//a write_fn for the receiver, it splits the in order bytes of the stream back into the files
+void session_write(void * sink, const char * data, size_t len){
+    session * s = sink;
+
+    while (len > 0){
+        if (s->fd < 0){
+            // we first need the fixed part of the header to know how long the path is
+            size_t want = (s->header_size == 0 ? SESSION_FRAME_HDR : s->header_size) - s->header_len;
+            if (want > len) {want = len;}
+            memcpy(s->header + s->header_len, data, want);
+            s->header_len += want;
+            data += want;
+            len -= want;
+
+            if (s->header_size == 0 && s->header_len == SESSION_FRAME_HDR){
+                uint16_t path_len;
+                uint64_t size;
+                memcpy(&path_len, s->header, 2);
+                memcpy(&size, s->header + 2, 8);
+                path_len = ntohs(path_len);
+                s->left = be64toh(size);
+                if (path_len == 0 || path_len > SESSION_PATH_MAX || s->left < 0){
+                    fprintf(stderr, "ERROR, corrupted session frame\n");
+                    exit(1);
+                }
+                s->header_size = SESSION_FRAME_HDR + path_len;
+            }
+
+            if (s->header_size != 0 && s->header_len == s->header_size){
+                create_file(s);
+                s->header_len = 0;
+                s->header_size = 0;
+
+                // an empty file has no data to wait for
+                if (s->left == 0){
+                    close_file(s);
+                }
+            }
+            continue;
+        }
+
+        size_t n = len;
+        if ((int64_t) n > s->left) {n = s->left;}
+        ssize_t written = write(s->fd, data, n);
+        if (written < 0){
+            if (errno == EINTR) {continue;}
+            error("write");
+        }
+        data += written;
+        len -= written;
+        s->left -= written;
+        s->bytes += written;
+
+        if (s->left == 0){
+            close_file(s);
+        }
+    }
+}
+
+//closes what is still open, returns 0 if the stream stopped in the middle of a file
+int session_finish(session * s){
+    int complete = s->fd < 0 && s->header_len == 0;
+    if (s->fd >= 0){
+        close(s->fd);
+        s->fd = -1;
+    }
+    return complete;
+}
+
+void free_session(session * s){
+    session_finish(s);
+    for (int i = 0; i < s->count; i++){
+        free(s->paths[i]);
+        free(s->names[i]);
+    }
+    free(s->paths);
+    free(s->names);
+    free(s->dir);
+    free(s);
+}
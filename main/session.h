@@ -0,0 +1,39 @@
+#ifndef SESSION_H_INCLUDED
+#define SESSION_H_INCLUDED
+#include<stdio.h>
+#include<stdint.h>
+
+#define SESSION_FRAME_HDR 10 //every file is framed by the length of its path and its size
+#define SESSION_PATH_MAX 4096 //the longest path we send
+
+//many files sent back to back over one connection, each one behind a frame header with its path and size
+typedef struct {
+    int receiver; //0 on the sender, 1 on the receiver
+
+    // sender side, the files we send and the name the receiver gives each of them
+    char ** paths;
+    char ** names;
+    int count;
+    int next; //the next file we open
+
+    // receiver side, where the files go
+    char * dir;
+
+    int fd; //the file we are reading or writing, -1 between files
+    int64_t left; //the bytes of that file that are still to come
+    char header[SESSION_FRAME_HDR + SESSION_PATH_MAX + 1]; //the frame header, followed by the path
+    size_t header_len; //how much of the header we have, or how much of it we sent
+    size_t header_size; //the length of the whole header once it is known
+
+    // statistics for the report
+    int files;
+    uint64_t bytes;
+} session;
+
+session * create_session(char ** inputs, int count);
+long session_read(void * source, char * dst, size_t len);
+session * create_session_writer(const char * dir);
+void session_write(void * sink, const char * data, size_t len);
+int session_finish(session * s);
+void free_session(session * s);
+#endif
@@ -0,0 +1,409 @@
+#define _GNU_SOURCE
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<errno.h>
+#include<stdint.h>
+#include<stddef.h>
+#include<stdatomic.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<sys/eventfd.h>
+#include<sys/epoll.h>
+#include<arpa/inet.h>
+
+#include"packet.h"
+#include"transport.h"
+
+#define SHM_SLOTS 1024 //the packets a ring holds, more than the receiver window so that a ring is never what drops a packet
+#define SHM_EVENTS 64 //the most epoll events the listener takes at once
+#define SHM_WAKE (1ULL << 32) //tags the eventfds in the listener's epoll set, the rest of it are sockets
+
+//single producer single consumer ring of packets, in the memory the sender shares with the receiver
+typedef struct {
+    _Alignas(64) atomic_long head; //the next packet the consumer takes, only the consumer moves it
+    _Alignas(64) atomic_long tail; //the next slot the producer fills, only the producer moves it
+    _Alignas(64) atomic_int waiting; //set by a consumer that found the ring empty, the producer then wakes it up
+    int lengths[SHM_SLOTS];
+    char slots[SHM_SLOTS][MSS_SIZE];
+} shm_ring;
+
+//the memfd a sender passes to the receiver, one ring each way
+typedef struct {
+    shm_ring to_receiver;
+    shm_ring to_sender;
+} shm_channel;
+
+//our end of a channel
+typedef struct {
+    shm_channel * channel; //NULL until the sender's fds arrived
+    shm_ring * tx;
+    shm_ring * rx;
+    int wake_tx; //the eventfd the peer polls
+    int wake_rx; //the eventfd we poll
+    int sock; //the unix socket the fds came over, it hangs up once the sender is gone
+    int closed;
+    struct sockaddr_in addr; //the address the receiver's connections know the sender by
+} shm_peer;
+
+//the sender has a single peer and polls its eventfd, the receiver has one peer per sender and polls an epoll set of all of them
+typedef struct {
+    transport base;
+    int sock; //the listening unix socket, -1 on the sender
+    shm_peer ** peers;
+    int count;
+    int next; //the peer recv looks at first, so that one busy sender does not starve the others
+    uint16_t next_port;
+} shm_transport;
+
+//the abstract unix socket of the receiver on port, it goes away with the receiver
+static socklen_t shm_address(struct sockaddr_un * addr, int port){
+    bzero((char *) addr, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    int n = snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "rdt-%d", port);
+    return offsetof(struct sockaddr_un, sun_path) + 1 + n;
+}
+
+static shm_peer * create_peer(){
+    shm_peer * p = calloc(1, sizeof(shm_peer));
+    p->wake_tx = -1;
+    p->wake_rx = -1;
+    p->sock = -1;
+    return p;
+}
+
+static void free_peer(shm_peer * p){
+    if (p->channel != NULL) {munmap(p->channel, sizeof(shm_channel));}
+    if (p->wake_tx >= 0) {close(p->wake_tx);}
+    if (p->wake_rx >= 0) {close(p->wake_rx);}
+    if (p->sock >= 0) {close(p->sock);}
+    free(p);
+}
+
+//clears an eventfd, the counter only tells us that something happened
+static void drain_eventfd(int fd){
+    uint64_t count;
+    while (read(fd, &count, sizeof(count)) < 0 && errno == EINTR);
+}
+
+//takes the oldest packet of the ring, -1 if it is empty
+static long ring_pop(shm_ring * r, void * pkt, size_t len){
+    long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&r->tail, memory_order_acquire)) {
+        return -1;
+    }
+
+    // the length comes from the other process, it never makes us read past the slot
+    size_t n = (unsigned) r->lengths[head % SHM_SLOTS];
+    if (n > MSS_SIZE) {n = MSS_SIZE;}
+    if (n > len) {n = len;}
+    memcpy(pkt, r->slots[head % SHM_SLOTS], n);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return n;
+}
+
+//asks the producer to wake us up with the next packet, returns 1 if one arrived before it could see the flag
+static int ring_wait(shm_ring * r){
+    atomic_store(&r->waiting, 1);
+    return atomic_load_explicit(&r->head, memory_order_relaxed) != atomic_load(&r->tail);
+}
+
+static shm_peer * find_peer(shm_transport * s, const struct sockaddr_in * to){
+    if (to == NULL) {
+        return s->count > 0 ? s->peers[0] : NULL;
+    }
+    for (int i = 0; i < s->count; i++) {
+        if (s->peers[i]->channel != NULL && s->peers[i]->addr.sin_port == to->sin_port) {
+            return s->peers[i];
+        }
+    }
+    return NULL;
+}
+
+//copies the packet into the peer's ring, a full ring drops it like a full socket buffer would
+static long shm_send(transport * t, const void * pkt, size_t len, const struct sockaddr_in * to){
+    shm_peer * p = find_peer((shm_transport *) t, to);
+    if (p == NULL || p->closed) {
+        errno = ENOTCONN;
+        return -1;
+    }
+    if (len > MSS_SIZE) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    shm_ring * r = p->tx;
+    long tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&r->head, memory_order_acquire) == SHM_SLOTS) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    memcpy(r->slots[tail % SHM_SLOTS], pkt, len);
+    r->lengths[tail % SHM_SLOTS] = len;
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+
+    // the consumer sets waiting before it checks the ring a last time, so either it sees our packet or we see its flag
+    // a busy consumer never set it, and we skip the system call
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&r->waiting, memory_order_relaxed) && atomic_exchange(&r->waiting, 0)) {
+        uint64_t one = 1;
+        while (write(p->wake_tx, &one, sizeof(one)) < 0 && errno == EINTR);
+    }
+    return len;
+}
+
+//takes the fds of a new sender off its socket, a sender that sends anything else is dropped
+static void receive_channel(shm_transport * s, shm_peer * p){
+    char byte;
+    int fds[3];
+    char control[CMSG_SPACE(sizeof(fds))];
+    struct iovec iov = {.iov_base = &byte, .iov_len = 1};
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = control, .msg_controllen = sizeof(control)};
+
+    long n = recvmsg(p->sock, &msg, MSG_CMSG_CLOEXEC);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
+    struct cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+    if (n <= 0 || cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        p->closed = 1;
+        return;
+    }
+    int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    memcpy(fds, CMSG_DATA(cmsg), (count < 3 ? count : 3) * sizeof(int));
+    if (count != 3) {
+        for (int i = 0; i < count && i < 3; i++) {close(fds[i]);}
+        p->closed = 1;
+        return;
+    }
+    p->wake_rx = fds[1];
+    p->wake_tx = fds[2];
+
+    // a memfd of the wrong size would fault when we touch what is not there, the seal keeps the sender from shrinking it later
+    struct stat st;
+    int seals = fcntl(fds[0], F_GET_SEALS);
+    void * channel = MAP_FAILED;
+    if (fstat(fds[0], &st) == 0 && st.st_size == sizeof(shm_channel) && seals >= 0 && (seals & F_SEAL_SHRINK)) {
+        channel = mmap(NULL, sizeof(shm_channel), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    }
+    close(fds[0]);
+    if (channel == MAP_FAILED) {
+        p->closed = 1;
+        return;
+    }
+    p->channel = channel;
+    p->tx = &p->channel->to_sender;
+    p->rx = &p->channel->to_receiver;
+
+    // the connections tell the senders apart by address, every one gets a port of its own
+    if (++s->next_port == 0) {s->next_port = 1;}
+    p->addr.sin_family = AF_INET;
+    p->addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    p->addr.sin_port = htons(s->next_port);
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.u64 = SHM_WAKE | (uint32_t) p->wake_rx};
+    epoll_ctl(s->base.fd, EPOLL_CTL_ADD, p->wake_rx, &ev);
+}
+
+//takes every sender that connected, its fds follow on its socket
+static void accept_peers(shm_transport * s){
+    int fd;
+    while ((fd = accept4(s->sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        shm_peer * p = create_peer();
+        p->sock = fd;
+        s->peers = realloc(s->peers, (s->count + 1) * sizeof(shm_peer *));
+        s->peers[s->count++] = p;
+
+        struct epoll_event ev = {.events = EPOLLIN, .data.u64 = (uint32_t) fd};
+        epoll_ctl(s->base.fd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+//the sender's socket became readable, it is either its fds or its hang up
+static void peer_event(shm_transport * s, int fd){
+    for (int i = 0; i < s->count; i++) {
+        shm_peer * p = s->peers[i];
+        if (p->sock != fd) {continue;}
+
+        if (p->channel == NULL) {
+            receive_channel(s, p);
+        }
+        // what the sender sent before it went away is still read, the peer goes once its ring is empty
+        else if (atomic_load(&p->rx->head) == atomic_load(&p->rx->tail)) {
+            p->closed = 1;
+        }
+        return;
+    }
+}
+
+//runs the listener's events, new senders, their fds and their hang ups, and clears the eventfds that woke us
+static void listener_events(shm_transport * s){
+    struct epoll_event events[SHM_EVENTS];
+    int n;
+
+    do {
+        n = epoll_wait(s->base.fd, events, SHM_EVENTS, 0);
+        for (int i = 0; i < n; i++) {
+            int fd = (int) (uint32_t) events[i].data.u64;
+            if (events[i].data.u64 & SHM_WAKE) {
+                drain_eventfd(fd);
+            }
+            else if (fd == s->sock) {
+                accept_peers(s);
+            }
+            else {
+                peer_event(s, fd);
+            }
+        }
+
+        // closed peers go only after the whole batch, their fds may still be in it
+        for (int i = 0; i < s->count; i++) {
+            if (s->peers[i]->closed) {
+                free_peer(s->peers[i]);
+                s->peers[i--] = s->peers[--s->count];
+            }
+        }
+    } while (n == SHM_EVENTS);
+}
+
+//takes the next packet of any sender, -1 with EAGAIN once every ring is empty and we asked to be woken up
+static long shm_recv(transport * t, void * pkt, size_t len, struct sockaddr_in * from){
+    shm_transport * s = (shm_transport *) t;
+
+    while (1) {
+        for (int i = 0; i < s->count; i++) {
+            int k = (s->next + i) % s->count;
+            shm_peer * p = s->peers[k];
+            if (p->channel == NULL) {continue;}
+
+            long n = ring_pop(p->rx, pkt, len);
+            if (n >= 0) {
+                s->next = k + 1;
+                if (from != NULL) {*from = p->addr;}
+                return n;
+            }
+        }
+
+        if (s->sock >= 0) {
+            listener_events(s);
+        }
+        else {
+            drain_eventfd(s->base.fd);
+        }
+
+        // we sleep only if every producer will wake us, a packet that beat the flag is taken right away
+        int arrived = 0;
+        for (int i = 0; i < s->count; i++) {
+            if (s->peers[i]->channel != NULL) {
+                arrived |= ring_wait(s->peers[i]->rx);
+            }
+        }
+        if (!arrived) {
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+}
+
+static void shm_close(transport * t){
+    shm_transport * s = (shm_transport *) t;
+    for (int i = 0; i < s->count; i++) {
+        free_peer(s->peers[i]);
+    }
+    if (s->sock >= 0) {
+        close(s->sock);
+        close(s->base.fd);
+    }
+    free(s->peers);
+    free(s);
+}
+
+static shm_transport * create_shm(){
+    shm_transport * s = calloc(1, sizeof(shm_transport));
+    s->base.send = shm_send;
+    s->base.recv = shm_recv;
+    s->base.close = shm_close;
+    s->base.fd = -1;
+    s->sock = -1;
+    return s;
+}
+
+//maps the rings into a memfd and passes it with both eventfds over the peer's socket, -1 if any step fails
+static int send_channel(shm_peer * p, int memfd){
+    if (ftruncate(memfd, sizeof(shm_channel)) < 0 || fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        return -1;
+    }
+    void * channel = mmap(NULL, sizeof(shm_channel), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (channel == MAP_FAILED) {
+        return -1;
+    }
+    p->channel = channel;
+    p->tx = &p->channel->to_receiver;
+    p->rx = &p->channel->to_sender;
+
+    // both ends start out asleep, the first packet each way wakes the other one up
+    atomic_store(&p->channel->to_receiver.waiting, 1);
+    atomic_store(&p->channel->to_sender.waiting, 1);
+
+    int fds[3] = {memfd, p->wake_tx, p->wake_rx};
+    char byte = 0;
+    char control[CMSG_SPACE(sizeof(fds))];
+    struct iovec iov = {.iov_base = &byte, .iov_len = 1};
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = control, .msg_controllen = sizeof(control)};
+    struct cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    return sendmsg(p->sock, &msg, 0) < 0 ? -1 : 0;
+}
+
+//creates the rings of a transfer to the receiver on port of this host and passes them to it
+transport * shm_connect(int port){
+    shm_transport * s = create_shm();
+    shm_peer * p = create_peer();
+    s->peers = malloc(sizeof(shm_peer *));
+    s->peers[s->count++] = p;
+
+    // the receiver gets the memory and both eventfds, we keep the socket open until we are done
+    struct sockaddr_un addr;
+    socklen_t addrlen = shm_address(&addr, port);
+    int memfd = memfd_create("rdt", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    p->wake_tx = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    p->wake_rx = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    p->sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    int ok = memfd >= 0 && p->wake_tx >= 0 && p->wake_rx >= 0 && p->sock >= 0 &&
+            connect(p->sock, (struct sockaddr *) &addr, addrlen) == 0 && send_channel(p, memfd) == 0;
+
+    if (memfd >= 0) {close(memfd);}
+    if (!ok) {
+        shm_close(&s->base);
+        return NULL;
+    }
+    s->base.fd = p->wake_rx;
+    return &s->base;
+}
+
+//listens for the senders on this host that reach us at port
+transport * shm_listen(int port){
+    shm_transport * s = create_shm();
+
+    struct sockaddr_un addr;
+    socklen_t addrlen = shm_address(&addr, port);
+    s->sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    s->base.fd = epoll_create1(EPOLL_CLOEXEC);
+    if (s->sock < 0 || s->base.fd < 0 || bind(s->sock, (struct sockaddr *) &addr, addrlen) < 0 || listen(s->sock, SOMAXCONN) < 0) {
+        if (s->sock >= 0) {close(s->sock);}
+        if (s->base.fd >= 0) {close(s->base.fd);}
+        free(s);
+        return NULL;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.u64 = (uint32_t) s->sock};
+    epoll_ctl(s->base.fd, EPOLL_CTL_ADD, s->sock, &ev);
+    return &s->base;
+}
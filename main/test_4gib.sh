@@ -0,0 +1,43 @@
+#!/bin/bash
+# resumes a transfer just below 4 GiB, so the sequence numbers, the ACKs, the file offsets
+# and the checkpoint all have to get past 2^32 for the output to match the input
+#
+# the first OFFSET bytes of both files are a sparse hole, so this needs little disk space and time
+set -e
+
+OBJDIR=${OBJDIR:-../obj}
+PORT=${PORT:-$((20000 + RANDOM % 10000))}
+BELOW=$((32 << 20))
+ABOVE=$((64 << 20))
+OFFSET=$(((1 << 32) - BELOW))
+
+dir=$(mktemp -d)
+RX=
+cleanup() {
+    if [ -n "$RX" ]; then kill $RX 2>/dev/null || true; fi
+    rm -rf "$dir"
+}
+trap cleanup EXIT
+
+# the receiver already has the hole, the sender still has to send the data on both sides of 2^32
+truncate -s $OFFSET "$dir/input.bin"
+head -c $((BELOW + ABOVE)) /dev/urandom >> "$dir/input.bin"
+truncate -s $OFFSET "$dir/output.bin"
+$OBJDIR/seed_checkpoint "$dir/input.bin" "$dir/output.bin" $OFFSET
+
+$OBJDIR/rdt_receiver $PORT "$dir/output.bin" 2>"$dir/recv.log" & RX=$!
+sleep 0.5
+$OBJDIR/rdt_sender -v 127.0.0.1 $PORT "$dir/input.bin" 2>"$dir/send.log"
+wait $RX
+RX=
+
+if ! grep -q "Resuming transfer .* at offset $OFFSET\$" "$dir/send.log"; then
+    echo "FAIL: the sender did not resume at offset $OFFSET"
+    grep -v "^[0-9]" "$dir/send.log" | tail -5
+    exit 1
+fi
+if ! cmp "$dir/input.bin" "$dir/output.bin"; then
+    echo "FAIL: the output differs from the input"
+    exit 1
+fi
+echo "PASS: resumed at $OFFSET and received $(stat -c %s "$dir/output.bin") bytes"
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <inttypes.h>
+#include <sys/wait.h>
+
+#include "common.h"
+#include "rdt.h"
+
+// how many senders connect to the one receiver unless the first argument says otherwise, and how many bytes each one sends
+// the streams are short enough that the senders' windows together rarely overflow the listener's socket buffer, this tests the listener and not loss recovery
+#define SENDERS 200
+#define SENDER_BYTES (64 << 10)
+
+// the test fails if the transfers take longer than this many milliseconds
+#define TEST_TIMEOUT 60000
+
+// the byte at offset of sender's stream, every sender sends different bytes so that a mixed up stream shows
+static char pattern(int sender, int64_t offset) {
+    return (char) (offset * 131 + (offset >> 9) + sender * 7);
+}
+
+// runs every sender in this one thread, each with a socket of its own, and exits with 0 once the receiver ACKed all of their FINs
+static void run_senders(int port, int senders) {
+    rdt_conn *conns[senders];
+    int64_t written[senders];
+    struct pollfd pfd[senders];
+    char buffer[DATA_SIZE];
+
+    for (int i = 0; i < senders; i++) {
+        transport *t = udp_connect("127.0.0.1", port);
+        if (t == NULL) {
+            error("connect");
+        }
+        // the transfer ID tells the receiver which sender it is
+        conns[i] = rdt_connect(t, i + 1, 0);
+        written[i] = 0;
+    }
+
+    int open = senders;
+    while (open > 0) {
+        int timeout = -1;
+        open = 0;
+        for (int i = 0; i < senders; i++) {
+            rdt_conn *c = conns[i];
+            if (rdt_state(c) != RDT_SYN_SENT && rdt_state(c) != RDT_ESTABLISHED) {
+                pfd[i].fd = -1;
+                continue;
+            }
+            open++;
+
+            while (rdt_state(c) == RDT_ESTABLISHED && written[i] < SENDER_BYTES) {
+                int len = SENDER_BYTES - written[i] < DATA_SIZE ? SENDER_BYTES - written[i] : DATA_SIZE;
+                for (int k = 0; k < len; k++) {
+                    buffer[k] = pattern(i, written[i] + k);
+                }
+                long n = rdt_write(c, buffer, len);
+                if (n < 0) {
+                    break;
+                }
+                written[i] += n;
+                if (written[i] == SENDER_BYTES) {
+                    rdt_shutdown(c);
+                }
+            }
+
+            pfd[i].fd = rdt_fd(c);
+            pfd[i].events = POLLIN;
+            int t = rdt_timeout(c);
+            if (t >= 0 && (timeout < 0 || t < timeout)) {
+                timeout = t;
+            }
+        }
+        if (open == 0) {
+            break;
+        }
+
+        poll(pfd, senders, timeout);
+        for (int i = 0; i < senders; i++) {
+            if (pfd[i].fd >= 0) {
+                rdt_tick(conns[i]);
+            }
+        }
+    }
+
+    int status = 0;
+    for (int i = 0; i < senders; i++) {
+        if (rdt_state(conns[i]) != RDT_CLOSED) {
+            fprintf(stderr, "FAIL: sender %d did not complete its transfer\n", i);
+            status = 1;
+        }
+        rdt_close(conns[i]);
+    }
+    exit(status);
+}
+
+// serves every sender from one listener in this one thread, only the connections rdt_ready names are read
+int main(int argc, char **argv) {
+    int senders = argc > 1 ? atoi(argv[1]) : SENDERS;
+    int port = argc > 2 ? atoi(argv[2]) : 20000 + getpid() % 10000;
+    char buffer[16 * DATA_SIZE];
+
+    transport *t = udp_listen(port);
+    if (t == NULL) {
+        error("listen");
+    }
+    rdt_listener *listener = rdt_listen(t);
+
+    // the child inherits nothing it would print
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        error("fork");
+    }
+    if (pid == 0) {
+        run_senders(port, senders);
+    }
+
+    rdt_conn *conns[senders];
+    int64_t received[senders];
+    int done[senders];
+    memset(conns, 0, sizeof(conns));
+    memset(received, 0, sizeof(received));
+    memset(done, 0, sizeof(done));
+
+    int status = 0;
+    int finished = 0;
+    int child = -1;
+    double seconds = 0;
+    uint64_t start = now_usec();
+    while (status == 0) {
+        // once every stream ended we answer repeated FINs until every sender saw our FIN_ACK and the senders exited
+        if (finished == senders && waitpid(pid, &child, WNOHANG) == pid) {
+            break;
+        }
+        if ((now_usec() - start) / 1000 >= TEST_TIMEOUT) {
+            fprintf(stderr, "FAIL: %d of %d transfers completed in %d ms\n", finished, senders, TEST_TIMEOUT);
+            status = 1;
+            break;
+        }
+        int timeout = rdt_listener_timeout(listener);
+        if (timeout < 0 || timeout > 100) {
+            timeout = 100;
+        }
+
+        struct pollfd pfd = {.fd = rdt_listener_fd(listener), .events = POLLIN};
+        poll(&pfd, 1, timeout);
+        rdt_listener_tick(listener);
+
+        rdt_conn *c;
+        while ((c = rdt_accept(listener)) != NULL) {
+            uint64_t id = rdt_transfer_id(c);
+            if (id < 1 || id > (uint64_t) senders || conns[id - 1] != NULL) {
+                fprintf(stderr, "FAIL: unexpected connection for transfer %" PRIu64 "\n", id);
+                status = 1;
+                rdt_close(c);
+                continue;
+            }
+            conns[id - 1] = c;
+            rdt_start(c, 0, 0);
+        }
+
+        while ((c = rdt_ready(listener)) != NULL) {
+            int i = rdt_transfer_id(c) - 1;
+            long len;
+            while ((len = rdt_read(c, buffer, sizeof(buffer))) > 0) {
+                for (long k = 0; k < len; k++) {
+                    if (buffer[k] != pattern(i, received[i] + k)) {
+                        fprintf(stderr, "FAIL: sender %d's byte at %" PRId64 " is wrong\n", i, received[i] + k);
+                        status = 1;
+                        break;
+                    }
+                }
+                received[i] += len;
+            }
+            if (len == 0 && !done[i]) {
+                if (received[i] != SENDER_BYTES) {
+                    fprintf(stderr, "FAIL: sender %d's stream ended after %" PRId64 " bytes\n", i, received[i]);
+                    status = 1;
+                }
+                done[i] = 1;
+                if (++finished == senders) {
+                    seconds = (now_usec() - start) / 1000000.0;
+                }
+            }
+            else if (len < 0 && errno != EAGAIN) {
+                fprintf(stderr, "FAIL: reading sender %d: %s\n", i, strerror(errno));
+                status = 1;
+            }
+        }
+    }
+    if (status != 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    else if (!WIFEXITED(child) || WEXITSTATUS(child) != 0) {
+        fprintf(stderr, "FAIL: the senders did not all see their FIN ACKed\n");
+        status = 1;
+    }
+
+    for (int i = 0; i < senders; i++) {
+        if (conns[i] != NULL) {
+            rdt_close(conns[i]);
+        }
+    }
+    rdt_listener_close(listener);
+
+    if (status == 0) {
+        printf("PASS: %d senders sent %d bytes each to one listener in one thread in %.3f s\n", senders, SENDER_BYTES, seconds);
+    }
+    return status;
+}
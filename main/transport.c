@@ -0,0 +1,97 @@
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<sys/socket.h>
+#include<arpa/inet.h>
+
+#include"transport.h"
+
+static long udp_send(transport * t, const void * pkt, size_t len, const struct sockaddr_in * to){
+    if (to == NULL) {
+        return send(t->fd, pkt, len, 0);
+    }
+    return sendto(t->fd, pkt, len, 0, (const struct sockaddr *) to, sizeof(*to));
+}
+
+static long udp_recv(transport * t, void * pkt, size_t len, struct sockaddr_in * from){
+    while (1) {
+        socklen_t addrlen = sizeof(*from);
+        long n = recvfrom(t->fd, pkt, len, 0, (struct sockaddr *) from, from != NULL ? &addrlen : NULL);
+        if (n < 0 && errno == EINTR) {continue;}
+        return n;
+    }
+}
+
+static void udp_close(transport * t){
+    close(t->fd);
+    free(t);
+}
+
+//a UDP socket, connected to the receiver on the sender and bound to the port on the receiver
+static transport * create_udp(){
+    transport * t = calloc(1, sizeof(transport));
+    t->send = udp_send;
+    t->recv = udp_recv;
+    t->close = udp_close;
+    t->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (t->fd < 0) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+//a non-blocking socket that only gets the datagrams of the receiver at hostname:port
+transport * udp_connect(const char * hostname, int port){
+    struct sockaddr_in addr;
+
+    bzero((char *) &addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_aton(hostname, &addr.sin_addr) == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    transport * t = create_udp();
+    if (t == NULL) {
+        return NULL;
+    }
+    if (connect(t->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || fcntl(t->fd, F_SETFL, O_NONBLOCK) < 0) {
+        udp_close(t);
+        return NULL;
+    }
+    return t;
+}
+
+//a non-blocking socket bound to port that every sender sends to
+transport * udp_listen(int port){
+    struct sockaddr_in addr;
+    int optval = 1;
+
+    transport * t = create_udp();
+    if (t == NULL) {
+        return NULL;
+    }
+
+    /* setsockopt: Handy debugging trick that lets
+     * us rerun the server immediately after we kill it
+     */
+    setsockopt(t->fd, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval , sizeof(int));
+
+    // the default buffer holds fewer datagrams than we advertise, a burst on loopback would overflow it
+    int rcvbuf = UDP_RCVBUF;
+    setsockopt(t->fd, SOL_SOCKET, SO_RCVBUF, (const void *)&rcvbuf , sizeof(int));
+
+    bzero((char *) &addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((unsigned short)port);
+    if (bind(t->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || fcntl(t->fd, F_SETFL, O_NONBLOCK) < 0) {
+        udp_close(t);
+        return NULL;
+    }
+    return t;
+}
@@ -0,0 +1,23 @@
+#ifndef TRANSPORT_H_INCLUDED
+#define TRANSPORT_H_INCLUDED
+#include<stddef.h>
+#include<netinet/in.h>
+
+#define UDP_RCVBUF (4 << 20) //the receive buffer the listener asks for, a burst of a whole receive window must fit, the kernel caps it at net.core.rmem_max
+
+//how packets get to the peer, the connections never touch a socket themselves
+typedef struct transport transport;
+struct transport {
+    int fd; //readable when recv may have a packet, poll it
+    //sends one packet to the peer at to, NULL on a connected transport, -1 if it was refused and counts as lost
+    long (*send)(transport * t, const void * pkt, size_t len, const struct sockaddr_in * to);
+    //takes the next packet that arrived and where it came from if from is not NULL, -1 with EAGAIN if there is none
+    long (*recv)(transport * t, void * pkt, size_t len, struct sockaddr_in * from);
+    void (*close)(transport * t);
+};
+
+transport * udp_connect(const char * hostname, int port);
+transport * udp_listen(int port);
+transport * shm_connect(int port);
+transport * shm_listen(int port);
+#endif